@@ -0,0 +1,96 @@
+#include "AudioInput.h"
+#include <iostream>
+
+bool openAudioInput(const std::string& filename, AudioInput& input) {
+    closeAudioInput(input);
+
+    input.formatContext = avformat_alloc_context();
+    if (!input.formatContext) {
+        std::cerr << "Failed to allocate format context" << std::endl;
+        return false;
+    }
+
+    // Open input file (frees the context on failure)
+    if (avformat_open_input(&input.formatContext, filename.c_str(), nullptr, nullptr) != 0) {
+        std::cerr << "Failed to open input file: " << filename << std::endl;
+        input.formatContext = nullptr;
+        return false;
+    }
+
+    // Retrieve stream information
+    if (avformat_find_stream_info(input.formatContext, nullptr) < 0) {
+        std::cerr << "Failed to find stream information" << std::endl;
+        closeAudioInput(input);
+        return false;
+    }
+
+    // Find audio stream
+    input.streamIndex = -1;
+    for (unsigned int i = 0; i < input.formatContext->nb_streams; i++) {
+        if (input.formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+            input.streamIndex = i;
+            break;
+        }
+    }
+
+    if (input.streamIndex == -1) {
+        std::cerr << "No audio stream found" << std::endl;
+        closeAudioInput(input);
+        return false;
+    }
+
+    input.stream = input.formatContext->streams[input.streamIndex];
+
+    // Get codec
+    const AVCodec* codec = avcodec_find_decoder(input.stream->codecpar->codec_id);
+    if (!codec) {
+        std::cerr << "Codec not found" << std::endl;
+        closeAudioInput(input);
+        return false;
+    }
+
+    // Allocate codec context
+    input.codecContext = avcodec_alloc_context3(codec);
+    if (!input.codecContext) {
+        std::cerr << "Failed to allocate codec context" << std::endl;
+        closeAudioInput(input);
+        return false;
+    }
+
+    // Copy codec parameters
+    if (avcodec_parameters_to_context(input.codecContext, input.stream->codecpar) < 0) {
+        std::cerr << "Failed to copy codec parameters" << std::endl;
+        closeAudioInput(input);
+        return false;
+    }
+
+    // Open codec
+    if (avcodec_open2(input.codecContext, codec, nullptr) < 0) {
+        std::cerr << "Failed to open codec" << std::endl;
+        closeAudioInput(input);
+        return false;
+    }
+
+    // Calculate duration
+    if (input.formatContext->duration != AV_NOPTS_VALUE) {
+        input.duration = (double)input.formatContext->duration / AV_TIME_BASE;
+    } else {
+        input.duration = 0.0;
+    }
+
+    return true;
+}
+
+void closeAudioInput(AudioInput& input) {
+    if (input.codecContext) {
+        avcodec_free_context(&input.codecContext);
+    }
+
+    if (input.formatContext) {
+        avformat_close_input(&input.formatContext);
+    }
+
+    input.stream = nullptr;
+    input.streamIndex = -1;
+    input.duration = 0.0;
+}
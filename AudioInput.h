@@ -0,0 +1,25 @@
+#ifndef AUDIOINPUT_H
+#define AUDIOINPUT_H
+
+#include <string>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+// Demuxer and decoder for the first audio stream of a file. Shared by the
+// player and the headless tools so they all open files the same way.
+struct AudioInput {
+    AVFormatContext* formatContext = nullptr;
+    AVCodecContext* codecContext = nullptr;
+    AVStream* stream = nullptr;
+    int streamIndex = -1;
+    double duration = 0.0;  // seconds, 0 if unknown
+};
+
+// On failure everything is released and an error is written to stderr
+bool openAudioInput(const std::string& filename, AudioInput& input);
+void closeAudioInput(AudioInput& input);
+
+#endif // AUDIOINPUT_H
@@ -0,0 +1,67 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Small helpers shared by the bench_* executables. None of them are part
+// of the default build; see "Benchmarks" in README.md.
+namespace Bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Seconds per fn() call. After one untimed warm-up call the batch size
+// doubles until a batch takes a few milliseconds; the result is the best
+// of several batches of that size, which filters out scheduler noise.
+template <typename Fn>
+double secondsPerCall(Fn&& fn, double minSeconds = 0.25) {
+    constexpr int kRounds = 8;
+    fn();
+
+    int64_t batch = 1;
+    double elapsed = 0.0;
+    while (true) {
+        auto start = Clock::now();
+        for (int64_t i = 0; i < batch; i++) {
+            fn();
+        }
+        elapsed = secondsSince(start);
+        if (elapsed >= minSeconds / kRounds) {
+            break;
+        }
+        batch *= 2;
+    }
+
+    double best = elapsed;
+    for (int round = 1; round < kRounds; round++) {
+        auto start = Clock::now();
+        for (int64_t i = 0; i < batch; i++) {
+            fn();
+        }
+        best = std::min(best, secondsSince(start));
+    }
+    return best / static_cast<double>(batch);
+}
+
+// Keeps a result alive so the optimizer cannot drop the work behind it
+inline void keep(int64_t value) {
+    static volatile int64_t sink;
+    sink = sink + value;
+}
+
+inline void printRule(int width) {
+    for (int i = 0; i < width; i++) {
+        std::putchar('-');
+    }
+    std::putchar('\n');
+}
+
+} // namespace Bench
+
+#endif // BENCH_H
@@ -0,0 +1,323 @@
+#include "ChannelMatrix.h"
+#include "SampleConvert.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define CHANNELMATRIX_SSE 1
+#endif
+
+namespace {
+
+constexpr double kHalfPower = 0.70710678118654752;
+
+enum class Side { Left, Right, Center };
+
+Side sideOf(AVChannel channel) {
+    switch (channel) {
+        case AV_CHAN_FRONT_LEFT:
+        case AV_CHAN_FRONT_LEFT_OF_CENTER:
+        case AV_CHAN_SIDE_LEFT:
+        case AV_CHAN_BACK_LEFT:
+        case AV_CHAN_WIDE_LEFT:
+        case AV_CHAN_SURROUND_DIRECT_LEFT:
+        case AV_CHAN_STEREO_LEFT:
+        case AV_CHAN_TOP_FRONT_LEFT:
+        case AV_CHAN_TOP_BACK_LEFT:
+            return Side::Left;
+        case AV_CHAN_FRONT_RIGHT:
+        case AV_CHAN_FRONT_RIGHT_OF_CENTER:
+        case AV_CHAN_SIDE_RIGHT:
+        case AV_CHAN_BACK_RIGHT:
+        case AV_CHAN_WIDE_RIGHT:
+        case AV_CHAN_SURROUND_DIRECT_RIGHT:
+        case AV_CHAN_STEREO_RIGHT:
+        case AV_CHAN_TOP_FRONT_RIGHT:
+        case AV_CHAN_TOP_BACK_RIGHT:
+            return Side::Right;
+        default:
+            return Side::Center;
+    }
+}
+
+// Builds one input channel's column of the matrix
+class Router {
+public:
+    Router(const AVChannelLayout& out, std::vector<double>& coefficients, int inputs, int input)
+        : m_out(out), m_coefficients(coefficients), m_inputs(inputs), m_input(input) {}
+
+    bool has(AVChannel channel) const {
+        return av_channel_layout_index_from_channel(&m_out, channel) >= 0;
+    }
+
+    // Adds `gain` towards `channel` if the output has it
+    bool add(AVChannel channel, double gain) {
+        int index = av_channel_layout_index_from_channel(&m_out, channel);
+        if (index < 0) {
+            return false;
+        }
+        m_coefficients[static_cast<size_t>(index) * m_inputs + m_input] += gain;
+        return true;
+    }
+
+    bool addPair(AVChannel left, AVChannel right, Side side, double gain) {
+        if (!has(left) || !has(right)) {
+            return false;
+        }
+        if (side == Side::Center) {
+            add(left, gain * kHalfPower);
+            add(right, gain * kHalfPower);
+        } else {
+            add(side == Side::Left ? left : right, gain);
+        }
+        return true;
+    }
+
+    // Last resort: the front pair, or the center speaker of a mono output
+    void addFront(Side side, double gain) {
+        if (side == Side::Center) {
+            if (has(AV_CHAN_FRONT_LEFT) && has(AV_CHAN_FRONT_RIGHT)) {
+                add(AV_CHAN_FRONT_LEFT, gain);
+                add(AV_CHAN_FRONT_RIGHT, gain);
+                return;
+            }
+        } else if (add(side == Side::Left ? AV_CHAN_FRONT_LEFT : AV_CHAN_FRONT_RIGHT, gain)) {
+            return;
+        } else {
+            // Both halves of a pair meet in one speaker: -3 dB each, like swr
+            gain *= kHalfPower;
+        }
+        if (!add(AV_CHAN_FRONT_CENTER, gain)) {
+            // Exotic output without a front: spread evenly
+            const int outputs = m_out.nb_channels;
+            for (int o = 0; o < outputs; o++) {
+                m_coefficients[static_cast<size_t>(o) * m_inputs + m_input] += gain / outputs;
+            }
+        }
+    }
+
+private:
+    const AVChannelLayout& m_out;
+    std::vector<double>& m_coefficients;
+    int m_inputs;
+    int m_input;
+};
+
+// dst = src * gain, or dst += src * gain
+void applyTap(float* dst, const float* src, float gain, int frames, bool accumulate) {
+    int i = 0;
+#ifdef CHANNELMATRIX_SSE
+    const __m128 g = _mm_set1_ps(gain);
+    if (accumulate) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+            _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), v));
+        }
+    } else {
+        for (; i + 4 <= frames; i += 4) {
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        }
+    }
+#endif
+    if (accumulate) {
+        for (; i < frames; i++) {
+            dst[i] += src[i] * gain;
+        }
+    } else {
+        for (; i < frames; i++) {
+            dst[i] = src[i] * gain;
+        }
+    }
+}
+
+} // namespace
+
+ChannelMatrix::ChannelMatrix()
+    : m_inputs(0)
+    , m_outputs(0)
+{
+}
+
+bool ChannelMatrix::build(const AVChannelLayout& in, const AVChannelLayout& out, const Gains& gains) {
+    m_inputs = in.nb_channels;
+    m_outputs = out.nb_channels;
+    if (m_inputs <= 0 || m_outputs <= 0) {
+        m_inputs = m_outputs = 0;
+        return false;
+    }
+
+    // Worked out in double and rounded once, so default gains give exactly
+    // the float coefficients swr mixes with
+    std::vector<double> matrix(static_cast<size_t>(m_inputs) * m_outputs, 0.0);
+
+    for (int i = 0; i < m_inputs; i++) {
+        AVChannel channel = av_channel_layout_channel_from_index(&in, i);
+        Router route(out, matrix, m_inputs, i);
+
+        if (channel != AV_CHAN_NONE && channel != AV_CHAN_UNKNOWN && route.add(channel, 1.0)) {
+            continue;
+        }
+
+        Side side = sideOf(channel);
+        switch (channel) {
+            case AV_CHAN_LOW_FREQUENCY:
+            case AV_CHAN_LOW_FREQUENCY_2:
+                if (!route.add(AV_CHAN_LOW_FREQUENCY, 1.0) && gains.lfe > 0.0) {
+                    route.addFront(Side::Center, gains.lfe);
+                }
+                break;
+            case AV_CHAN_FRONT_CENTER:
+                route.addFront(Side::Center, gains.center);
+                break;
+            case AV_CHAN_FRONT_LEFT:
+            case AV_CHAN_FRONT_RIGHT:
+                // FL/FR only get here without a front pair (mono): they are
+                // main channels, so the surround gain does not apply
+            case AV_CHAN_FRONT_LEFT_OF_CENTER:
+            case AV_CHAN_FRONT_RIGHT_OF_CENTER:
+                route.addFront(side, 1.0);
+                break;
+            case AV_CHAN_BACK_LEFT:
+            case AV_CHAN_BACK_RIGHT:
+                if (!route.addPair(AV_CHAN_SIDE_LEFT, AV_CHAN_SIDE_RIGHT, side, 1.0) &&
+                    !route.add(AV_CHAN_BACK_CENTER, kHalfPower)) {
+                    route.addFront(side, gains.surround);
+                }
+                break;
+            case AV_CHAN_SIDE_LEFT:
+            case AV_CHAN_SIDE_RIGHT:
+                if (!route.addPair(AV_CHAN_BACK_LEFT, AV_CHAN_BACK_RIGHT, side, 1.0)) {
+                    route.addFront(side, gains.surround);
+                }
+                break;
+            case AV_CHAN_BACK_CENTER:
+                if (!route.addPair(AV_CHAN_BACK_LEFT, AV_CHAN_BACK_RIGHT, Side::Center, 1.0) &&
+                    !route.addPair(AV_CHAN_SIDE_LEFT, AV_CHAN_SIDE_RIGHT, Side::Center, 1.0)) {
+                    route.addFront(Side::Center, gains.surround * kHalfPower);
+                }
+                break;
+            default:
+                // Wides, heights and unknown positions fold into the front
+                route.addFront(side, side == Side::Center ? kHalfPower : gains.surround);
+                break;
+        }
+    }
+
+    // Same clipping protection swr applies for integer output
+    if (gains.normalize) {
+        double loudest = 0.0;
+        for (int o = 0; o < m_outputs; o++) {
+            double sum = 0.0;
+            for (int i = 0; i < m_inputs; i++) {
+                sum += std::fabs(matrix[static_cast<size_t>(o) * m_inputs + i]);
+            }
+            loudest = std::max(loudest, sum);
+        }
+        if (loudest > 1.0) {
+            for (double& c : matrix) {
+                c /= loudest;
+            }
+        }
+    }
+    m_coefficients.assign(matrix.begin(), matrix.end());
+
+    m_taps.clear();
+    m_tapStart.assign(m_outputs + 1, 0);
+    for (int o = 0; o < m_outputs; o++) {
+        m_tapStart[o] = static_cast<int>(m_taps.size());
+        for (int i = 0; i < m_inputs; i++) {
+            float gain = m_coefficients[static_cast<size_t>(o) * m_inputs + i];
+            if (gain != 0.0f) {
+                m_taps.push_back({i, gain});
+            }
+        }
+    }
+    m_tapStart[m_outputs] = static_cast<int>(m_taps.size());
+
+    m_planar.assign(static_cast<size_t>(BLOCK_FRAMES) * m_outputs, 0.0f);
+    m_interleaved.assign(static_cast<size_t>(BLOCK_FRAMES) * m_outputs, 0.0f);
+    return true;
+}
+
+float ChannelMatrix::coefficient(int output, int input) const {
+    if (output < 0 || output >= m_outputs || input < 0 || input >= m_inputs) {
+        return 0.0f;
+    }
+    return m_coefficients[static_cast<size_t>(output) * m_inputs + input];
+}
+
+void ChannelMatrix::process(const float* const* planes, int16_t* out, int frames) {
+    const int outputs = m_outputs;
+
+    for (int done = 0; done < frames; done += BLOCK_FRAMES) {
+        const int count = std::min(BLOCK_FRAMES, frames - done);
+
+        for (int o = 0; o < outputs; o++) {
+            float* acc = m_planar.data() + static_cast<size_t>(o) * BLOCK_FRAMES;
+            const int first = m_tapStart[o];
+            const int last = m_tapStart[o + 1];
+            if (first == last) {
+                std::fill(acc, acc + count, 0.0f);
+                continue;
+            }
+            for (int t = first; t < last; t++) {
+                applyTap(acc, planes[m_taps[t].input] + done, m_taps[t].gain, count, t != first);
+            }
+        }
+
+        // Interleave, then the shared saturating S16 conversion
+        float* interleaved = m_interleaved.data();
+        int i = 0;
+        if (outputs == 1) {
+            interleaved = m_planar.data();
+        } else if (outputs == 2) {
+            const float* left = m_planar.data();
+            const float* right = left + BLOCK_FRAMES;
+#ifdef CHANNELMATRIX_SSE
+            for (; i + 4 <= count; i += 4) {
+                __m128 l = _mm_loadu_ps(left + i);
+                __m128 r = _mm_loadu_ps(right + i);
+                _mm_storeu_ps(interleaved + i * 2, _mm_unpacklo_ps(l, r));
+                _mm_storeu_ps(interleaved + i * 2 + 4, _mm_unpackhi_ps(l, r));
+            }
+#endif
+            for (; i < count; i++) {
+                interleaved[i * 2] = left[i];
+                interleaved[i * 2 + 1] = right[i];
+            }
+        } else {
+            for (int o = 0; o < outputs; o++) {
+                const float* plane = m_planar.data() + static_cast<size_t>(o) * BLOCK_FRAMES;
+                for (int f = 0; f < count; f++) {
+                    interleaved[f * outputs + o] = plane[f];
+                }
+            }
+        }
+
+        SampleConvert::toS16(interleaved, out + static_cast<size_t>(done) * outputs, count * outputs);
+    }
+}
+
+std::string ChannelMatrix::describe(const AVChannelLayout& in, const AVChannelLayout& out) const {
+    std::string text;
+    char name[32];
+    char gain[16];
+    for (int o = 0; o < m_outputs; o++) {
+        av_channel_name(name, sizeof(name), av_channel_layout_channel_from_index(&out, o));
+        text += name;
+        text += " =";
+        if (m_tapStart[o] == m_tapStart[o + 1]) {
+            text += " 0";
+        }
+        for (int t = m_tapStart[o]; t < m_tapStart[o + 1]; t++) {
+            std::snprintf(gain, sizeof(gain), " %s%.2f ", t == m_tapStart[o] ? "" : "+ ", m_taps[t].gain);
+            av_channel_name(name, sizeof(name), av_channel_layout_channel_from_index(&in, m_taps[t].input));
+            text += gain;
+            text += name;
+        }
+        text += "\n";
+    }
+    return text;
+}
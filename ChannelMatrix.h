@@ -0,0 +1,63 @@
+#ifndef CHANNELMATRIX_H
+#define CHANNELMATRIX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
+
+// Remixes one channel layout into another with a gain matrix worked out
+// once from the channel positions: channels the output has are copied,
+// the rest are folded into their nearest neighbours (center and LFE into
+// the front pair, backs into sides or fronts, and so on). The decoding
+// thread then applies only the non-zero taps, four frames per SSE step,
+// and writes interleaved S16 the same way the conversion kernels do.
+class ChannelMatrix {
+public:
+    // Defaults are swr's: -3 dB center and surround, no LFE
+    struct Gains {
+        double center = 0.70710678118654752;     // FC into FL/FR when there is no center speaker
+        double surround = 0.70710678118654752;   // side/back channels into the front pair
+        double lfe = 0.0;                        // LFE into FL/FR when there is no LFE; 0 drops it
+        bool normalize = true;                   // scale down so no output channel can clip
+    };
+
+    ChannelMatrix();
+
+    // Control thread. False if either layout is empty.
+    bool build(const AVChannelLayout& in, const AVChannelLayout& out, const Gains& gains);
+
+    int inputChannels() const { return m_inputs; }
+    int outputChannels() const { return m_outputs; }
+    float coefficient(int output, int input) const;
+
+    // Decoding thread, no allocation: one float plane per input channel
+    // in, interleaved S16 out
+    void process(const float* const* planes, int16_t* out, int frames);
+
+    // e.g. "FL = 0.41 FL + 0.29 FC + 0.29 SL", one line per output
+    std::string describe(const AVChannelLayout& in, const AVChannelLayout& out) const;
+
+private:
+    static constexpr int BLOCK_FRAMES = 256;
+
+    struct Tap {
+        int input;
+        float gain;
+    };
+
+    int m_inputs;
+    int m_outputs;
+    std::vector<float> m_coefficients;  // [output][input]
+    std::vector<Tap> m_taps;            // non-zero coefficients grouped by output
+    std::vector<int> m_tapStart;        // outputs + 1 offsets into m_taps
+
+    // 解码线程的分块缓冲区（build 时分配）
+    std::vector<float> m_planar;        // BLOCK_FRAMES per output
+    std::vector<float> m_interleaved;
+};
+
+#endif // CHANNELMATRIX_H
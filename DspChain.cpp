@@ -0,0 +1,94 @@
+#include "DspChain.h"
+#include <algorithm>
+#include <iostream>
+
+DspChain::DspChain()
+    : m_count(0)
+    , m_sampleRate(0)
+    , m_channels(0)
+{
+    // Never reallocate while the decoding thread could hold the lock
+    m_processors.reserve(MAX_PROCESSORS);
+}
+
+void DspChain::addProcessor(std::shared_ptr<AudioProcessor> processor) {
+    if (!processor) {
+        return;
+    }
+
+    int sampleRate, channels;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        sampleRate = m_sampleRate;
+        channels = m_channels;
+    }
+
+    // Allocate state before the processor becomes visible
+    if (sampleRate > 0) {
+        processor->prepare(sampleRate, channels);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_processors.size() >= MAX_PROCESSORS) {
+        std::cerr << "DSP chain is full, processor not added" << std::endl;
+        return;
+    }
+    m_processors.push_back(std::move(processor));
+    m_count.store(m_processors.size(), std::memory_order_relaxed);
+}
+
+bool DspChain::removeProcessor(const std::shared_ptr<AudioProcessor>& processor) {
+    std::shared_ptr<AudioProcessor> removed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = std::find(m_processors.begin(), m_processors.end(), processor);
+        if (it == m_processors.end()) {
+            return false;
+        }
+        removed = std::move(*it);
+        m_processors.erase(it);
+        m_count.store(m_processors.size(), std::memory_order_relaxed);
+    }
+    // removed is released here, outside the lock
+    return true;
+}
+
+void DspChain::clear() {
+    std::vector<std::shared_ptr<AudioProcessor>> removed;
+    removed.reserve(MAX_PROCESSORS);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        removed.swap(m_processors);
+        m_processors.reserve(MAX_PROCESSORS);
+        m_count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void DspChain::prepare(int sampleRate, int channels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sampleRate = sampleRate;
+    m_channels = channels;
+    for (auto& processor : m_processors) {
+        processor->prepare(sampleRate, channels);
+    }
+}
+
+void DspChain::process(float* samples, int frames) {
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    for (auto& processor : m_processors) {
+        processor->process(samples, frames);
+    }
+}
+
+void DspChain::reset() {
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    for (auto& processor : m_processors) {
+        processor->reset();
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef DSPCHAIN_H
+#define DSPCHAIN_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A processing stage on the PCM path. Samples are interleaved float in
+// [-1, 1] and are processed in place.
+class AudioProcessor {
+public:
+    virtual ~AudioProcessor() = default;
+
+    // Control thread, playback not running: allocate all state here
+    virtual void prepare(int sampleRate, int channels) = 0;
+
+    // Decoding thread: must not allocate, lock or block
+    virtual void process(float* samples, int frames) = 0;
+
+    // Decoding thread: clear filter history (e.g. after a seek)
+    virtual void reset() = 0;
+};
+
+// Ordered list of processors run between decodeAudioFrame and
+// SDL_QueueAudio. Structural edits take a mutex the decoding thread only
+// try-locks, so a block that races an edit passes through unprocessed
+// instead of stalling playback.
+class DspChain {
+public:
+    DspChain();
+
+    void addProcessor(std::shared_ptr<AudioProcessor> processor);
+    bool removeProcessor(const std::shared_ptr<AudioProcessor>& processor);
+    void clear();
+    bool empty() const { return m_count.load(std::memory_order_relaxed) == 0; }
+
+    void prepare(int sampleRate, int channels);
+    void process(float* samples, int frames);
+    void reset();
+
+private:
+    static constexpr size_t MAX_PROCESSORS = 16;
+
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<AudioProcessor>> m_processors;
+    std::atomic<size_t> m_count;
+    int m_sampleRate;
+    int m_channels;
+};
+
+#endif // DSPCHAIN_H
@@ -0,0 +1,93 @@
+#include "Fft.h"
+#include <cmath>
+#include <utility>
+
+Fft::Fft(int size)
+    : m_size(size)
+    , m_bitReverse(size)
+    , m_cos(size / 2)
+    , m_sin(size / 2)
+{
+    int bits = 0;
+    while ((1 << bits) < size) bits++;
+
+    for (int i = 0; i < size; i++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            if (i & (1 << b)) reversed |= 1 << (bits - 1 - b);
+        }
+        m_bitReverse[i] = reversed;
+    }
+
+    for (int i = 0; i < size / 2; i++) {
+        double angle = -2.0 * M_PI * i / size;
+        m_cos[i] = static_cast<float>(std::cos(angle));
+        m_sin[i] = static_cast<float>(std::sin(angle));
+    }
+}
+
+void Fft::transform(float* real, float* imag) const {
+    const int n = m_size;
+
+    for (int i = 0; i < n; i++) {
+        int j = m_bitReverse[i];
+        if (j > i) {
+            std::swap(real[i], real[j]);
+            std::swap(imag[i], imag[j]);
+        }
+    }
+
+    // First stage has trivial twiddles
+    for (int i = 0; i < n; i += 2) {
+        float r = real[i + 1], m = imag[i + 1];
+        real[i + 1] = real[i] - r;
+        imag[i + 1] = imag[i] - m;
+        real[i] += r;
+        imag[i] += m;
+    }
+
+    for (int half = 2; half < n; half *= 2) {
+        const int stride = n / (half * 2);
+        for (int start = 0; start < n; start += half * 2) {
+            float* reA = real + start;
+            float* imA = imag + start;
+            float* reB = reA + half;
+            float* imB = imA + half;
+            // Contiguous inner loop over k: vectorizable apart from the
+            // strided twiddle gather
+            for (int k = 0; k < half; k++) {
+                float wr = m_cos[k * stride];
+                float wi = m_sin[k * stride];
+                float tr = reB[k] * wr - imB[k] * wi;
+                float ti = reB[k] * wi + imB[k] * wr;
+                reB[k] = reA[k] - tr;
+                imB[k] = imA[k] - ti;
+                reA[k] += tr;
+                imA[k] += ti;
+            }
+        }
+    }
+}
+
+void Fft::magnitudes(const float* input, float* scratch, float* output) const {
+    float* real = scratch;
+    float* imag = scratch + m_size;
+    for (int i = 0; i < m_size; i++) {
+        real[i] = input[i];
+        imag[i] = 0.0f;
+    }
+
+    transform(real, imag);
+
+    for (int i = 0; i <= m_size / 2; i++) {
+        output[i] = std::sqrt(real[i] * real[i] + imag[i] * imag[i]);
+    }
+}
+
+std::vector<float> makeHannWindow(int size) {
+    std::vector<float> window(size);
+    for (int i = 0; i < size; i++) {
+        window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * M_PI * i / size));
+    }
+    return window;
+}
@@ -0,0 +1,33 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <vector>
+
+// Self-contained iterative radix-2 FFT on split real/imaginary arrays.
+// Twiddles and the bit-reversal permutation are computed once in the
+// constructor, and the butterfly loops run over contiguous arrays so the
+// compiler can vectorize them.
+class Fft {
+public:
+    explicit Fft(int size);  // size must be a power of two
+
+    int size() const { return m_size; }
+
+    // In place, forward transform, no scaling
+    void transform(float* real, float* imag) const;
+
+    // Magnitudes of bins 0..size/2 from a real input. `scratch` must hold
+    // 2 * size floats; output must hold size/2 + 1.
+    void magnitudes(const float* input, float* scratch, float* output) const;
+
+private:
+    int m_size;
+    std::vector<int> m_bitReverse;
+    std::vector<float> m_cos;
+    std::vector<float> m_sin;
+};
+
+// Hann window coefficients of the given length
+std::vector<float> makeHannWindow(int size);
+
+#endif // FFT_H
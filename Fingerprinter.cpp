@@ -0,0 +1,661 @@
+#include "Fingerprinter.h"
+#include "AudioInput.h"
+#include "Fft.h"
+#include "LibraryIndex.h"
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FINGERPRINTER_SSE 1
+#endif
+
+namespace {
+
+const char kCacheMagic[8] = { 'M', 'W', 'F', 'P', 'R', 'I', 'N', 'T' };
+const uint32_t kCacheVersion = 2;
+
+// Frequency range the bands cover; most of the energy that survives lossy
+// encoding is here
+const double kLowestHz = 300.0;
+const double kHighestHz = 2000.0;
+
+// Index limits. Entries pack the rest of the word in 28 bits, the file in
+// 22 and the frame in 14, enough for 90 s at one word per hop; words shared
+// by many entries (silence, hum) carry no information.
+const uint32_t kMaxIndexedFiles = 1u << 22;
+const uint32_t kMaxIndexedFrames = 1u << 14;
+const size_t kMaxGroupSize = 32;
+const int kShardBits = 4;
+const uint32_t kMinVotes = 2;
+const int kMaxOffsetsPerPair = 4;   // most voted offsets tried before giving up
+const int kMinOverlap = 800;   // words, about 4.6 s
+
+inline int popcount32(uint32_t value) {
+#if defined(__GNUC__)
+    return __builtin_popcount(value);
+#else
+    return static_cast<int>(std::bitset<32>(value).count());
+#endif
+}
+
+// One bit per neighbouring band pair: did the energy difference grow since
+// the previous frame?
+inline uint32_t packBits(const float* difference, const float* previous) {
+#ifdef FINGERPRINTER_SSE
+    const __m128 zero = _mm_setzero_ps();
+    uint32_t bits = 0;
+    for (int i = 0; i < 32; i += 4) {
+        __m128 change = _mm_sub_ps(_mm_loadu_ps(difference + i), _mm_loadu_ps(previous + i));
+        bits |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpgt_ps(change, zero))) << i;
+    }
+    return bits;
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < 32; i++) {
+        if (difference[i] - previous[i] > 0.0f) {
+            bits |= 1u << i;
+        }
+    }
+    return bits;
+#endif
+}
+
+// FFT bin edges of the log-spaced bands
+std::vector<int> bandEdges() {
+    std::vector<int> edges(Fingerprinter::BAND_COUNT + 1);
+    const double binHz = static_cast<double>(Fingerprinter::SAMPLE_RATE) / Fingerprinter::FFT_SIZE;
+    for (int b = 0; b <= Fingerprinter::BAND_COUNT; b++) {
+        double hz = kLowestHz * std::pow(kHighestHz / kLowestHz,
+                                         static_cast<double>(b) / Fingerprinter::BAND_COUNT);
+        edges[b] = static_cast<int>(std::lround(hz / binHz));
+    }
+    // Every band gets at least one bin
+    for (int b = 1; b <= Fingerprinter::BAND_COUNT; b++) {
+        edges[b] = std::max(edges[b], edges[b - 1] + 1);
+    }
+    return edges;
+}
+
+// Decoder-side FFmpeg state, released in one place whatever the outcome
+struct DecodeSession {
+    AudioInput input;
+    SwrContext* swr = nullptr;
+    AVPacket* packet = nullptr;
+    AVFrame* frame = nullptr;
+
+    ~DecodeSession() {
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        swr_free(&swr);
+        closeAudioInput(input);
+    }
+};
+
+// Resamples one frame (nullptr drains swr) onto the end of `pcm`
+bool appendConverted(SwrContext* swr, const AVFrame* frame, std::vector<float>& pcm) {
+    int inSamples = frame ? frame->nb_samples : 0;
+    int outSamples = swr_get_out_samples(swr, inSamples);
+    if (outSamples <= 0) {
+        return true;
+    }
+
+    size_t start = pcm.size();
+    pcm.resize(start + outSamples);
+    uint8_t* output[1] = { reinterpret_cast<uint8_t*>(pcm.data() + start) };
+    int converted = swr_convert(swr, output, outSamples,
+                                frame ? const_cast<const uint8_t**>(frame->extended_data) : nullptr,
+                                inSamples);
+    if (converted < 0) {
+        pcm.resize(start);
+        return false;
+    }
+    pcm.resize(start + converted);
+    return true;
+}
+
+bool writeAll(FILE* file, const void* data, size_t size) {
+    return fwrite(data, 1, size, file) == size;
+}
+
+bool readAll(FILE* file, void* data, size_t size) {
+    return fread(data, 1, size, file) == size;
+}
+
+} // namespace
+
+Fingerprinter::Fingerprinter(const Options& options)
+    : m_options(options)
+    , m_nextJob(0)
+    , m_finishedJobs(0)
+{
+}
+
+bool Fingerprinter::compute(const std::string& path, Fingerprint& fingerprint) {
+    DecodeSession session;
+    if (!openAudioInput(path, session.input)) {
+        return false;
+    }
+    AVCodecContext* decoder = session.input.codecContext;
+
+    // Downmix and resample in one step
+    AVChannelLayout mono = AV_CHANNEL_LAYOUT_MONO;
+    AVChannelLayout inputLayout;
+    if (decoder->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC) {
+        av_channel_layout_default(&inputLayout, decoder->ch_layout.nb_channels);
+    } else {
+        av_channel_layout_copy(&inputLayout, &decoder->ch_layout);
+    }
+    int ret = swr_alloc_set_opts2(&session.swr,
+                                  &mono, AV_SAMPLE_FMT_FLT, SAMPLE_RATE,
+                                  &inputLayout, decoder->sample_fmt, decoder->sample_rate,
+                                  0, nullptr);
+    av_channel_layout_uninit(&inputLayout);
+    if (ret < 0 || swr_init(session.swr) < 0) {
+        return false;
+    }
+
+    session.packet = av_packet_alloc();
+    session.frame = av_frame_alloc();
+    if (!session.packet || !session.frame) {
+        return false;
+    }
+
+    const size_t maxSamples = static_cast<size_t>(MAX_SECONDS) * SAMPLE_RATE;
+    std::vector<float> pcm;
+    pcm.reserve(maxSamples + SAMPLE_RATE);
+
+    bool draining = false;
+    while (pcm.size() < maxSamples) {
+        if (!draining) {
+            if (av_read_frame(session.input.formatContext, session.packet) < 0) {
+                draining = true;
+                avcodec_send_packet(decoder, nullptr);
+            } else {
+                if (session.packet->stream_index == session.input.streamIndex) {
+                    // Corrupt packets are skipped, as in playback
+                    avcodec_send_packet(decoder, session.packet);
+                }
+                av_packet_unref(session.packet);
+            }
+        }
+
+        int received;
+        while ((received = avcodec_receive_frame(decoder, session.frame)) >= 0) {
+            bool converted = appendConverted(session.swr, session.frame, pcm);
+            av_frame_unref(session.frame);
+            if (!converted) {
+                return false;
+            }
+        }
+        if (draining && received == AVERROR_EOF) {
+            appendConverted(session.swr, nullptr, pcm);
+            break;
+        }
+    }
+
+    computeWords(pcm.data(), pcm.size(), fingerprint);
+    fingerprint.duration = session.input.duration > 0.0
+                               ? static_cast<float>(session.input.duration)
+                               : static_cast<float>(std::min(pcm.size(), maxSamples)) / SAMPLE_RATE;
+    return !fingerprint.words.empty();
+}
+
+void Fingerprinter::computeWords(const float* pcm, size_t samples, Fingerprint& fingerprint) {
+    samples = std::min(samples, static_cast<size_t>(MAX_SECONDS) * SAMPLE_RATE);
+
+    Fft fft(FFT_SIZE);
+    const std::vector<float> window = makeHannWindow(FFT_SIZE);
+    const std::vector<int> edges = bandEdges();
+    std::vector<float> windowed(FFT_SIZE);
+    std::vector<float> scratch(FFT_SIZE * 2);
+    std::vector<float> magnitudes(FFT_SIZE / 2 + 1);
+    float energy[BAND_COUNT];
+    float difference[BAND_COUNT - 1];
+    float previous[BAND_COUNT - 1];
+
+    fingerprint.words.clear();
+    bool havePrevious = false;
+    for (size_t start = 0; start + FFT_SIZE <= samples; start += HOP_SIZE) {
+        for (int i = 0; i < FFT_SIZE; i++) {
+            windowed[i] = pcm[start + i] * window[i];
+        }
+        fft.magnitudes(windowed.data(), scratch.data(), magnitudes.data());
+
+        for (int b = 0; b < BAND_COUNT; b++) {
+            float sum = 0.0f;
+            for (int bin = edges[b]; bin < edges[b + 1]; bin++) {
+                sum += magnitudes[bin] * magnitudes[bin];
+            }
+            energy[b] = sum;
+        }
+        for (int b = 0; b < BAND_COUNT - 1; b++) {
+            difference[b] = energy[b] - energy[b + 1];
+        }
+
+        if (havePrevious) {
+            fingerprint.words.push_back(packBits(difference, previous));
+        }
+        std::memcpy(previous, difference, sizeof(previous));
+        havePrevious = true;
+    }
+}
+
+float Fingerprinter::bitErrorRate(const Fingerprint& a, const Fingerprint& b, int offset, int& overlap) {
+    int first = std::max(0, -offset);
+    int last = std::min(static_cast<int>(b.words.size()), static_cast<int>(a.words.size()) - offset);
+    overlap = std::max(0, last - first);
+    if (overlap == 0) {
+        return 1.0f;
+    }
+
+    int errors = 0;
+    for (int i = first; i < last; i++) {
+        errors += popcount32(a.words[i + offset] ^ b.words[i]);
+    }
+    return static_cast<float>(errors) / (32.0f * overlap);
+}
+
+void Fingerprinter::collectInputs(const std::vector<std::string>& inputs) {
+    namespace fs = std::filesystem;
+
+    std::vector<std::string> paths;
+    for (const auto& input : inputs) {
+        std::error_code error;
+        if (fs::is_directory(input, error)) {
+            fs::recursive_directory_iterator it(input, fs::directory_options::skip_permission_denied, error);
+            for (; !error && it != fs::recursive_directory_iterator(); it.increment(error)) {
+                if (it->is_regular_file(error) && LibraryBuilder::isAudioFile(it->path().string())) {
+                    paths.push_back(it->path().string());
+                }
+            }
+        } else {
+            paths.push_back(input);
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    m_jobs.clear();
+    for (auto& path : paths) {
+        auto job = std::make_unique<Job>();
+        std::error_code error;
+        job->size = fs::file_size(path, error);
+        if (!error) {
+            job->modified = fs::last_write_time(path, error).time_since_epoch().count();
+        }
+        job->path = std::move(path);
+        m_jobs.push_back(std::move(job));
+    }
+}
+
+bool Fingerprinter::loadCache() {
+    m_cache.clear();
+    if (m_options.cacheFile.empty()) {
+        return true;
+    }
+
+    FILE* file = fopen(m_options.cacheFile.c_str(), "rb");
+    if (!file) {
+        return false;  // No cache yet
+    }
+
+    char magic[8];
+    uint32_t version = 0, count = 0;
+    bool ok = readAll(file, magic, sizeof(magic)) && std::memcmp(magic, kCacheMagic, sizeof(magic)) == 0 &&
+              readAll(file, &version, sizeof(version)) && version == kCacheVersion &&
+              readAll(file, &count, sizeof(count));
+
+    for (uint32_t i = 0; ok && i < count; i++) {
+        uint32_t pathLength = 0, wordCount = 0;
+        CacheEntry entry;
+        std::string path;
+        ok = readAll(file, &pathLength, sizeof(pathLength)) && pathLength <= 65536;
+        if (ok) {
+            path.resize(pathLength);
+            ok = readAll(file, &path[0], pathLength) &&
+                 readAll(file, &entry.size, sizeof(entry.size)) &&
+                 readAll(file, &entry.modified, sizeof(entry.modified)) &&
+                 readAll(file, &entry.fingerprint.duration, sizeof(entry.fingerprint.duration)) &&
+                 readAll(file, &wordCount, sizeof(wordCount)) && wordCount <= kMaxIndexedFrames;
+        }
+        if (ok) {
+            entry.fingerprint.words.resize(wordCount);
+            ok = readAll(file, entry.fingerprint.words.data(), wordCount * sizeof(uint32_t));
+        }
+        if (ok) {
+            m_cache[path] = std::move(entry);
+        }
+    }
+    fclose(file);
+
+    if (!ok) {
+        std::cerr << "Ignoring damaged fingerprint cache: " << m_options.cacheFile << std::endl;
+        m_cache.clear();
+    }
+    return ok;
+}
+
+bool Fingerprinter::saveCache() const {
+    if (m_options.cacheFile.empty()) {
+        return true;
+    }
+
+    // Write a new file and swap it in, so an interrupted run keeps the old one
+    std::string temporary = m_options.cacheFile + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to create fingerprint cache: " << temporary << std::endl;
+        return false;
+    }
+
+    uint32_t count = static_cast<uint32_t>(m_cache.size());
+    bool ok = writeAll(file, kCacheMagic, sizeof(kCacheMagic)) &&
+              writeAll(file, &kCacheVersion, sizeof(kCacheVersion)) &&
+              writeAll(file, &count, sizeof(count));
+    for (const auto& item : m_cache) {
+        if (!ok) break;
+        const CacheEntry& entry = item.second;
+        uint32_t pathLength = static_cast<uint32_t>(item.first.size());
+        uint32_t wordCount = static_cast<uint32_t>(entry.fingerprint.words.size());
+        ok = writeAll(file, &pathLength, sizeof(pathLength)) &&
+             writeAll(file, item.first.data(), pathLength) &&
+             writeAll(file, &entry.size, sizeof(entry.size)) &&
+             writeAll(file, &entry.modified, sizeof(entry.modified)) &&
+             writeAll(file, &entry.fingerprint.duration, sizeof(entry.fingerprint.duration)) &&
+             writeAll(file, &wordCount, sizeof(wordCount)) &&
+             writeAll(file, entry.fingerprint.words.data(), wordCount * sizeof(uint32_t));
+    }
+    ok = (fclose(file) == 0) && ok;
+
+    std::error_code error;
+    if (ok) {
+        std::filesystem::rename(temporary, m_options.cacheFile, error);
+    }
+    if (!ok || error) {
+        std::cerr << "Failed to write fingerprint cache: " << m_options.cacheFile << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Fingerprinter::run(const std::vector<std::string>& inputs) {
+    collectInputs(inputs);
+    if (m_jobs.empty()) {
+        std::cerr << "No audio files found" << std::endl;
+        return false;
+    }
+
+    loadCache();
+    size_t cached = 0;
+    for (auto& job : m_jobs) {
+        auto entry = m_cache.find(job->path);
+        if (entry != m_cache.end() && entry->second.size == job->size &&
+            entry->second.modified == job->modified) {
+            job->fingerprint = entry->second.fingerprint;
+            job->cached = true;
+            job->ok = true;
+            cached++;
+        }
+    }
+    m_nextJob.store(0);
+    m_finishedJobs.store(cached);
+
+    int workers = m_options.jobs > 0 ? m_options.jobs
+                                     : static_cast<int>(std::thread::hardware_concurrency());
+    workers = std::max(1, std::min(workers, static_cast<int>(m_jobs.size() - cached)));
+
+    std::cout << "Fingerprinting " << m_jobs.size() << " file(s), " << cached
+              << " from cache, with " << workers << " worker(s)" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    if (cached < m_jobs.size()) {
+        for (int i = 0; i < workers; i++) {
+            threads.emplace_back(&Fingerprinter::workerLoop, this);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_doneMutex);
+        while (m_finishedJobs.load() < m_jobs.size()) {
+            m_doneCondition.wait_for(lock, std::chrono::seconds(1));
+            lock.unlock();
+            printProgress(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            lock.lock();
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t computed = 0, failed = 0;
+    for (const auto& job : m_jobs) {
+        if (!job->ok) {
+            std::cerr << "Failed: " << job->path << std::endl;
+            failed++;
+        } else if (!job->cached) {
+            computed++;
+            m_cache[job->path] = CacheEntry{ job->size, job->modified, job->fingerprint };
+        }
+    }
+
+    std::vector<const Fingerprint*> fingerprints;
+    for (const auto& job : m_jobs) {
+        fingerprints.push_back(job->ok ? &job->fingerprint : nullptr);
+    }
+    auto matchStart = std::chrono::steady_clock::now();
+    std::vector<Match> matches = findDuplicates(fingerprints, m_options.maxBitErrorRate);
+    double matchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - matchStart).count();
+
+    printGroups(matches);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "\n=== Fingerprint Summary ===" << std::endl;
+    std::cout << computed << " computed, " << cached << " cached, " << failed << " failed in "
+              << elapsed << "s (" << (elapsed > 0.0 ? computed / elapsed : 0.0) << " files/s)" << std::endl;
+    std::cout << "Matched " << (m_jobs.size() - failed) << " fingerprints in " << matchMs << " ms" << std::endl;
+    std::cout << "===========================" << std::endl;
+    std::cout << std::defaultfloat;
+
+    bool saved = computed == 0 || saveCache();
+    return saved && failed < m_jobs.size();
+}
+
+void Fingerprinter::workerLoop() {
+    size_t index;
+    while ((index = m_nextJob.fetch_add(1)) < m_jobs.size()) {
+        Job& job = *m_jobs[index];
+        if (job.cached) {
+            continue;
+        }
+
+        job.ok = compute(job.path, job.fingerprint);
+
+        m_finishedJobs.fetch_add(1);
+        m_doneCondition.notify_one();
+    }
+}
+
+std::vector<Fingerprinter::Match> Fingerprinter::findDuplicates(const std::vector<const Fingerprint*>& fingerprints,
+                                                                float maxBitErrorRate) {
+    // Entries are (word, file, frame) packed so one sort groups equal words.
+    // Processing one slice of the word space at a time bounds the memory to
+    // a fraction of the fingerprints themselves.
+    const int shards = 1 << kShardBits;
+    const int keyShift = 32 - kShardBits;
+    std::vector<uint64_t> entries;
+    std::unordered_map<uint64_t, uint32_t> votes;
+
+    const uint32_t files = static_cast<uint32_t>(std::min<size_t>(fingerprints.size(), kMaxIndexedFiles));
+
+    for (int shard = 0; shard < shards; shard++) {
+        entries.clear();
+        for (uint32_t f = 0; f < files; f++) {
+            if (!fingerprints[f]) continue;
+            const std::vector<uint32_t>& words = fingerprints[f]->words;
+            uint32_t frames = std::min<uint32_t>(static_cast<uint32_t>(words.size()), kMaxIndexedFrames);
+            for (uint32_t i = 0; i < frames; i++) {
+                uint32_t word = words[i];
+                if (word == 0 || word == 0xFFFFFFFFu || static_cast<int>(word >> keyShift) != shard) {
+                    continue;
+                }
+                uint64_t key = word & ((1u << keyShift) - 1);
+                entries.push_back((key << 36) | (static_cast<uint64_t>(f) << 14) | i);
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+
+        // Every pair of files sharing a word votes for their frame offset
+        for (size_t begin = 0; begin < entries.size();) {
+            size_t end = begin + 1;
+            while (end < entries.size() && (entries[end] >> 36) == (entries[begin] >> 36)) end++;
+
+            if (end - begin <= kMaxGroupSize) {
+                for (size_t x = begin; x < end; x++) {
+                    uint32_t fileA = static_cast<uint32_t>((entries[x] >> 14) & 0x3FFFFF);
+                    int frameA = static_cast<int>(entries[x] & 0x3FFF);
+                    for (size_t y = x + 1; y < end; y++) {
+                        uint32_t fileB = static_cast<uint32_t>((entries[y] >> 14) & 0x3FFFFF);
+                        if (fileA == fileB) continue;
+                        int offset = frameA - static_cast<int>(entries[y] & 0x3FFF);
+                        votes[(static_cast<uint64_t>(fileA) << 40) | (static_cast<uint64_t>(fileB) << 16) |
+                              static_cast<uint64_t>(offset + 32768)]++;
+                    }
+                }
+            }
+            begin = end;
+        }
+    }
+
+    struct Candidate {
+        uint32_t a, b;
+        int offset;
+        uint32_t votes;
+    };
+    std::vector<Candidate> candidates;
+    for (const auto& vote : votes) {
+        if (vote.second >= kMinVotes) {
+            candidates.push_back({ static_cast<uint32_t>(vote.first >> 40),
+                                   static_cast<uint32_t>((vote.first >> 16) & 0xFFFFFF),
+                                   static_cast<int>(vote.first & 0xFFFF) - 32768,
+                                   vote.second });
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& x, const Candidate& y) {
+        return x.votes > y.votes;
+    });
+
+    // Confirm with the bit error rate around the voted offset. Neighbouring
+    // frames share words, so one chance coincidence votes for a few offsets
+    // of the same pair; only the pair's best voted offsets are tried.
+    std::vector<Match> matches;
+    std::unordered_map<uint64_t, int> attempts;
+    for (const auto& candidate : candidates) {
+        uint64_t pair = (static_cast<uint64_t>(candidate.a) << 32) | candidate.b;
+        const Fingerprint& a = *fingerprints[candidate.a];
+        const Fingerprint& b = *fingerprints[candidate.b];
+        int& tried = attempts[pair];
+        if (tried >= kMaxOffsetsPerPair) continue;
+        tried++;
+
+        // Same recording, not just the same intro
+        float longer = std::max(a.duration, b.duration);
+        if (std::fabs(a.duration - b.duration) > std::max(3.0f, 0.02f * longer)) continue;
+
+        float best = 1.0f;
+        for (int delta = -1; delta <= 1; delta++) {
+            int overlap = 0;
+            float rate = bitErrorRate(a, b, candidate.offset + delta, overlap);
+            int needed = std::min(kMinOverlap, static_cast<int>(std::min(a.words.size(), b.words.size())) / 2);
+            if (overlap >= needed) {
+                best = std::min(best, rate);
+            }
+        }
+        if (best <= maxBitErrorRate) {
+            tried = kMaxOffsetsPerPair;
+            matches.push_back({ candidate.a, candidate.b, best });
+        }
+    }
+    return matches;
+}
+
+void Fingerprinter::printProgress(double elapsedSeconds) const {
+    size_t done = m_finishedJobs.load();
+    std::cout << std::fixed << std::setprecision(1)
+              << "[" << done << "/" << m_jobs.size() << "] "
+              << (elapsedSeconds > 0.0 ? done / elapsedSeconds : 0.0) << " files/s, "
+              << elapsedSeconds << "s elapsed" << std::defaultfloat << std::endl;
+}
+
+void Fingerprinter::printGroups(const std::vector<Match>& matches) const {
+    // Union-find over confirmed pairs
+    std::vector<uint32_t> parent(m_jobs.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&parent](uint32_t x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+    for (const auto& match : matches) {
+        parent[find(match.a)] = find(match.b);
+    }
+
+    std::unordered_map<uint32_t, std::vector<uint32_t>> groups;
+    for (const auto& match : matches) {
+        groups[find(match.a)];
+    }
+    for (uint32_t f = 0; f < m_jobs.size(); f++) {
+        auto group = groups.find(find(f));
+        if (group != groups.end()) group->second.push_back(f);
+    }
+
+    std::vector<std::vector<uint32_t>> ordered;
+    for (auto& group : groups) {
+        // Largest file first: usually the best encoding to keep
+        std::sort(group.second.begin(), group.second.end(), [this](uint32_t x, uint32_t y) {
+            return m_jobs[x]->size > m_jobs[y]->size;
+        });
+        ordered.push_back(std::move(group.second));
+    }
+    std::sort(ordered.begin(), ordered.end());
+
+    std::cout << "\n=== Duplicate Groups ===" << std::endl;
+    uint64_t reclaimable = 0;
+    for (size_t g = 0; g < ordered.size(); g++) {
+        std::cout << "Group " << (g + 1) << ":" << std::endl;
+        for (size_t i = 0; i < ordered[g].size(); i++) {
+            const Job& job = *m_jobs[ordered[g][i]];
+            std::cout << "  " << (i == 0 ? "* " : "  ") << job.path << " ("
+                      << std::fixed << std::setprecision(1) << job.size / 1048576.0 << " MiB)"
+                      << std::defaultfloat << std::endl;
+            if (i > 0) reclaimable += job.size;
+        }
+    }
+    if (ordered.empty()) {
+        std::cout << "(none)" << std::endl;
+    } else {
+        std::cout << ordered.size() << " group(s); removing all but the largest file in each frees "
+                  << std::fixed << std::setprecision(1) << reclaimable / 1048576.0 << " MiB"
+                  << std::defaultfloat << std::endl;
+    }
+    std::cout << "========================" << std::endl;
+}
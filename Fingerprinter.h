@@ -0,0 +1,103 @@
+#ifndef FINGERPRINTER_H
+#define FINGERPRINTER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Headless acoustic fingerprinting and duplicate detection. Each file is
+// decoded, downmixed and resampled to 11025 Hz mono; every hop of the first
+// 90 seconds becomes one 32-bit word whose bits are the signs of the change
+// in band-energy differences between neighbouring frames (Haitsma-Kalker).
+// Frames overlap by 31/32, so a copy that starts at any sample offset is at
+// most half a hop (3 ms) from a frame of the original. Re-encodes of the
+// same recording keep most bits, so they share many exact words at a
+// constant frame offset. Candidates are found through an index of
+// those words and confirmed by their bit error rate, never by comparing all
+// pairs. Fingerprints are cached by path, size and modification time.
+class Fingerprinter {
+public:
+    static constexpr int SAMPLE_RATE = 11025;
+    static constexpr int FFT_SIZE = 2048;
+    static constexpr int HOP_SIZE = 64;     // FFT_SIZE / 32
+    static constexpr int MAX_SECONDS = 90;
+    static constexpr int BAND_COUNT = 33;   // 32 bits from neighbouring band pairs
+
+    struct Options {
+        std::string cacheFile = "fingerprints.cache";   // empty = no cache
+        int jobs = 0;                   // 0 = one per hardware thread
+        float maxBitErrorRate = 0.35f;  // above this two files are different
+    };
+
+    struct Fingerprint {
+        float duration = 0.0f;          // seconds, whole file
+        std::vector<uint32_t> words;
+    };
+
+    explicit Fingerprinter(const Options& options);
+
+    // Expands directories, fingerprints every file (cached ones are reused),
+    // then prints duplicate groups and throughput. False if nothing could
+    // be fingerprinted or the cache could not be written.
+    bool run(const std::vector<std::string>& inputs);
+
+    struct Match {
+        uint32_t a;
+        uint32_t b;
+        float bitErrorRate;
+    };
+
+    // Decodes one file and computes its fingerprint
+    static bool compute(const std::string& path, Fingerprint& fingerprint);
+
+    // Words of mono PCM at SAMPLE_RATE; only the first MAX_SECONDS are used
+    static void computeWords(const float* pcm, size_t samples, Fingerprint& fingerprint);
+
+    // Confirmed duplicate pairs, as indices into `fingerprints`; null
+    // entries (failed files) are skipped
+    static std::vector<Match> findDuplicates(const std::vector<const Fingerprint*>& fingerprints,
+                                             float maxBitErrorRate);
+
+    // Fraction of differing bits where b[i] lines up with a[i + offset];
+    // `overlap` receives the number of compared words
+    static float bitErrorRate(const Fingerprint& a, const Fingerprint& b, int offset, int& overlap);
+
+private:
+    struct Job {
+        std::string path;
+        uint64_t size = 0;
+        int64_t modified = 0;
+        Fingerprint fingerprint;
+        bool cached = false;
+        bool ok = false;
+    };
+
+    struct CacheEntry {
+        uint64_t size;
+        int64_t modified;
+        Fingerprint fingerprint;
+    };
+
+    void collectInputs(const std::vector<std::string>& inputs);
+    bool loadCache();
+    bool saveCache() const;
+    void workerLoop();
+    void printProgress(double elapsedSeconds) const;
+    void printGroups(const std::vector<Match>& matches) const;
+
+    Options m_options;
+    std::vector<std::unique_ptr<Job>> m_jobs;
+    std::unordered_map<std::string, CacheEntry> m_cache;
+
+    std::atomic<size_t> m_nextJob;
+    std::atomic<size_t> m_finishedJobs;
+    std::mutex m_doneMutex;
+    std::condition_variable m_doneCondition;
+};
+
+#endif // FINGERPRINTER_H
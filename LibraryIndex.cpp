@@ -0,0 +1,668 @@
+#include "LibraryIndex.h"
+#include "AudioInput.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+
+namespace {
+
+// Snapshot layout: header, then 8-byte aligned sections. Offsets are in
+// bytes from the start of the snapshot, counts in elements.
+const char kMagic[8] = { 'M', 'W', 'L', 'I', 'B', 'I', 'D', 'X' };
+const uint32_t kVersion = 1;
+
+enum Section {
+    STRING_OFFSETS,   // uint32, stringCount + 1
+    STRING_DATA,      // char
+    PATH,             // uint32 string ids, one per track
+    TITLE,
+    ARTIST,
+    ALBUM,
+    GENRE,
+    CODEC,
+    TRACK_NUMBER,     // uint32
+    DURATION,         // float
+    SAMPLE_RATE,      // uint32
+    WEIGHT,           // float
+    BY_ARTIST,        // uint32 track permutations
+    BY_ALBUM,
+    BY_TITLE,
+    TRIGRAM_KEYS,     // uint32, sorted
+    TRIGRAM_OFFSETS,  // uint32, trigramCount + 1
+    POSTINGS,         // uint32 track ids
+    SECTION_COUNT
+};
+
+struct SectionEntry {
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t trackCount;
+    uint32_t stringCount;
+    uint32_t trigramCount;
+    SectionEntry sections[SECTION_COUNT];
+};
+
+const char* kAudioExtensions[] = {
+    "mp3", "flac", "wav", "ogg", "opus", "m4a", "aac", "wma", "aiff", "aif", "ape", "wv", "mka"
+};
+
+inline unsigned char foldChar(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
+
+std::string foldString(std::string_view text) {
+    std::string folded(text);
+    for (auto& c : folded) {
+        c = static_cast<char>(foldChar(static_cast<unsigned char>(c)));
+    }
+    return folded;
+}
+
+// ASCII case-insensitive three-way compare
+int compareFolded(std::string_view a, std::string_view b) {
+    size_t length = std::min(a.size(), b.size());
+    for (size_t i = 0; i < length; i++) {
+        unsigned char ca = foldChar(static_cast<unsigned char>(a[i]));
+        unsigned char cb = foldChar(static_cast<unsigned char>(b[i]));
+        if (ca != cb) {
+            return ca < cb ? -1 : 1;
+        }
+    }
+    if (a.size() == b.size()) return 0;
+    return a.size() < b.size() ? -1 : 1;
+}
+
+// `foldedNeedle` must already be folded
+bool containsFolded(std::string_view haystack, std::string_view foldedNeedle) {
+    if (foldedNeedle.size() > haystack.size()) {
+        return false;
+    }
+    for (size_t i = 0; i + foldedNeedle.size() <= haystack.size(); i++) {
+        size_t j = 0;
+        while (j < foldedNeedle.size() &&
+               foldChar(static_cast<unsigned char>(haystack[i + j])) ==
+                   static_cast<unsigned char>(foldedNeedle[j])) {
+            j++;
+        }
+        if (j == foldedNeedle.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint32_t trigramKey(const char* text) {
+    return (static_cast<uint32_t>(static_cast<unsigned char>(text[0])) << 16) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(text[1])) << 8) |
+           static_cast<uint32_t>(static_cast<unsigned char>(text[2]));
+}
+
+class SnapshotWriter {
+public:
+    SnapshotWriter() : m_bytes(sizeof(SnapshotHeader), 0) {
+        std::memset(&m_header, 0, sizeof(m_header));
+        std::memcpy(m_header.magic, kMagic, sizeof(kMagic));
+        m_header.version = kVersion;
+    }
+
+    SnapshotHeader& header() { return m_header; }
+
+    template <typename T>
+    void write(Section section, const std::vector<T>& values) {
+        m_bytes.resize((m_bytes.size() + 7) & ~size_t(7), 0);
+        m_header.sections[section].offset = m_bytes.size();
+        m_header.sections[section].count = values.size();
+        const char* raw = reinterpret_cast<const char*>(values.data());
+        m_bytes.insert(m_bytes.end(), raw, raw + values.size() * sizeof(T));
+    }
+
+    std::vector<uint64_t> finish() {
+        std::memcpy(m_bytes.data(), &m_header, sizeof(m_header));
+        std::vector<uint64_t> snapshot((m_bytes.size() + 7) / 8, 0);
+        std::memcpy(snapshot.data(), m_bytes.data(), m_bytes.size());
+        return snapshot;
+    }
+
+private:
+    SnapshotHeader m_header;
+    std::vector<char> m_bytes;
+};
+
+std::string metadataValue(const AudioInput& input, const char* key) {
+    AVDictionaryEntry* entry = av_dict_get(input.formatContext->metadata, key, nullptr, 0);
+    if (!entry && input.stream) {
+        entry = av_dict_get(input.stream->metadata, key, nullptr, 0);
+    }
+    return entry ? std::string(entry->value) : std::string();
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// LibraryBuilder
+
+void LibraryBuilder::add(const TrackInfo& track) {
+    m_tracks.push_back(track);
+}
+
+bool LibraryBuilder::addFile(const std::string& path) {
+    AudioInput input;
+    if (!openAudioInput(path, input)) {
+        return false;
+    }
+
+    TrackInfo track;
+    track.path = path;
+    track.title = metadataValue(input, "title");
+    track.artist = metadataValue(input, "artist");
+    track.album = metadataValue(input, "album");
+    track.genre = metadataValue(input, "genre");
+    track.trackNumber = static_cast<uint32_t>(std::atoi(metadataValue(input, "track").c_str()));
+    track.codec = avcodec_get_name(input.stream->codecpar->codec_id);
+    track.sampleRate = input.stream->codecpar->sample_rate;
+    track.duration = static_cast<float>(input.duration);
+
+    if (track.title.empty()) {
+        track.title = std::filesystem::path(path).stem().string();
+    }
+
+    closeAudioInput(input);
+    m_tracks.push_back(std::move(track));
+    return true;
+}
+
+bool LibraryBuilder::isAudioFile(const std::string& path) {
+    std::string extension = foldString(std::filesystem::path(path).extension().string());
+    if (!extension.empty() && extension[0] == '.') {
+        extension.erase(0, 1);
+    }
+    return std::any_of(std::begin(kAudioExtensions), std::end(kAudioExtensions),
+                       [&](const char* ext) { return extension == ext; });
+}
+
+size_t LibraryBuilder::scanDirectory(const std::string& directory) {
+    namespace fs = std::filesystem;
+
+    size_t added = 0;
+    std::error_code error;
+    fs::recursive_directory_iterator it(directory, fs::directory_options::skip_permission_denied, error);
+    if (error) {
+        std::cerr << "Cannot scan " << directory << ": " << error.message() << std::endl;
+        return 0;
+    }
+
+    for (; it != fs::recursive_directory_iterator(); it.increment(error)) {
+        if (error) {
+            break;
+        }
+        if (!it->is_regular_file(error)) {
+            continue;
+        }
+
+        if (isAudioFile(it->path().string()) && addFile(it->path().string())) {
+            added++;
+        }
+    }
+    return added;
+}
+
+std::vector<uint64_t> LibraryBuilder::build() const {
+    const uint32_t trackCount = static_cast<uint32_t>(m_tracks.size());
+
+    // Intern every string, then renumber in folded order
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string_view> strings;
+    auto intern = [&](const std::string& text) {
+        auto result = ids.emplace(text, static_cast<uint32_t>(strings.size()));
+        if (result.second) {
+            strings.push_back(result.first->first);
+        }
+        return result.first->second;
+    };
+
+    std::vector<uint32_t> columns[6];
+    for (auto& column : columns) {
+        column.reserve(trackCount);
+    }
+    for (const auto& track : m_tracks) {
+        columns[0].push_back(intern(track.path));
+        columns[1].push_back(intern(track.title));
+        columns[2].push_back(intern(track.artist));
+        columns[3].push_back(intern(track.album));
+        columns[4].push_back(intern(track.genre));
+        columns[5].push_back(intern(track.codec));
+    }
+
+    std::vector<uint32_t> order(strings.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        int folded = compareFolded(strings[a], strings[b]);
+        return folded != 0 ? folded < 0 : strings[a] < strings[b];
+    });
+
+    std::vector<uint32_t> remap(strings.size());
+    std::vector<uint32_t> stringOffsets;
+    std::vector<char> stringData;
+    stringOffsets.reserve(strings.size() + 1);
+    for (uint32_t i = 0; i < order.size(); i++) {
+        remap[order[i]] = i;
+        stringOffsets.push_back(static_cast<uint32_t>(stringData.size()));
+        stringData.insert(stringData.end(), strings[order[i]].begin(), strings[order[i]].end());
+    }
+    stringOffsets.push_back(static_cast<uint32_t>(stringData.size()));
+
+    for (auto& column : columns) {
+        for (auto& id : column) {
+            id = remap[id];
+        }
+    }
+    const auto& title = columns[1];
+    const auto& artist = columns[2];
+    const auto& album = columns[3];
+
+    std::vector<uint32_t> trackNumbers, sampleRates;
+    std::vector<float> durations, weights;
+    trackNumbers.reserve(trackCount);
+    sampleRates.reserve(trackCount);
+    durations.reserve(trackCount);
+    weights.reserve(trackCount);
+    for (const auto& track : m_tracks) {
+        trackNumbers.push_back(track.trackNumber);
+        sampleRates.push_back(track.sampleRate);
+        durations.push_back(track.duration);
+        weights.push_back(track.weight);
+    }
+
+    // Secondary indexes: ids already sort like their strings
+    std::vector<uint32_t> byArtist(trackCount), byAlbum(trackCount), byTitle(trackCount);
+    std::iota(byArtist.begin(), byArtist.end(), 0);
+    std::iota(byAlbum.begin(), byAlbum.end(), 0);
+    std::iota(byTitle.begin(), byTitle.end(), 0);
+    std::sort(byArtist.begin(), byArtist.end(), [&](uint32_t a, uint32_t b) {
+        if (artist[a] != artist[b]) return artist[a] < artist[b];
+        if (album[a] != album[b]) return album[a] < album[b];
+        if (trackNumbers[a] != trackNumbers[b]) return trackNumbers[a] < trackNumbers[b];
+        return title[a] < title[b];
+    });
+    std::sort(byAlbum.begin(), byAlbum.end(), [&](uint32_t a, uint32_t b) {
+        if (album[a] != album[b]) return album[a] < album[b];
+        if (trackNumbers[a] != trackNumbers[b]) return trackNumbers[a] < trackNumbers[b];
+        return title[a] < title[b];
+    });
+    std::sort(byTitle.begin(), byTitle.end(), [&](uint32_t a, uint32_t b) {
+        return title[a] != title[b] ? title[a] < title[b] : a < b;
+    });
+
+    // Trigram postings over folded title, artist and album
+    std::vector<uint64_t> pairs;
+    std::string folded;
+    for (uint32_t t = 0; t < trackCount; t++) {
+        size_t start = pairs.size();
+        for (const std::string* field : { &m_tracks[t].title, &m_tracks[t].artist, &m_tracks[t].album }) {
+            folded = foldString(*field);
+            for (size_t i = 0; i + 3 <= folded.size(); i++) {
+                pairs.push_back((static_cast<uint64_t>(trigramKey(folded.data() + i)) << 32) | t);
+            }
+        }
+        // Dedupe per track early to keep the global sort small
+        std::sort(pairs.begin() + start, pairs.end());
+        pairs.erase(std::unique(pairs.begin() + start, pairs.end()), pairs.end());
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    std::vector<uint32_t> trigramKeys, trigramOffsets, postings;
+    postings.reserve(pairs.size());
+    for (uint64_t pair : pairs) {
+        uint32_t key = static_cast<uint32_t>(pair >> 32);
+        if (trigramKeys.empty() || trigramKeys.back() != key) {
+            trigramKeys.push_back(key);
+            trigramOffsets.push_back(static_cast<uint32_t>(postings.size()));
+        }
+        postings.push_back(static_cast<uint32_t>(pair));
+    }
+    trigramOffsets.push_back(static_cast<uint32_t>(postings.size()));
+
+    SnapshotWriter writer;
+    writer.header().trackCount = trackCount;
+    writer.header().stringCount = static_cast<uint32_t>(strings.size());
+    writer.header().trigramCount = static_cast<uint32_t>(trigramKeys.size());
+    writer.write(STRING_OFFSETS, stringOffsets);
+    writer.write(STRING_DATA, stringData);
+    writer.write(PATH, columns[0]);
+    writer.write(TITLE, columns[1]);
+    writer.write(ARTIST, columns[2]);
+    writer.write(ALBUM, columns[3]);
+    writer.write(GENRE, columns[4]);
+    writer.write(CODEC, columns[5]);
+    writer.write(TRACK_NUMBER, trackNumbers);
+    writer.write(DURATION, durations);
+    writer.write(SAMPLE_RATE, sampleRates);
+    writer.write(WEIGHT, weights);
+    writer.write(BY_ARTIST, byArtist);
+    writer.write(BY_ALBUM, byAlbum);
+    writer.write(BY_TITLE, byTitle);
+    writer.write(TRIGRAM_KEYS, trigramKeys);
+    writer.write(TRIGRAM_OFFSETS, trigramOffsets);
+    writer.write(POSTINGS, postings);
+    return writer.finish();
+}
+
+// ---------------------------------------------------------------------------
+// LibraryIndex
+
+LibraryIndex::LibraryIndex() {
+    reset();
+}
+
+void LibraryIndex::reset() {
+    m_snapshot.clear();
+    m_trackCount = 0;
+    m_stringCount = 0;
+    m_stringOffsets = nullptr;
+    m_stringData = nullptr;
+    m_path = m_title = m_artist = m_album = m_genre = m_codec = nullptr;
+    m_trackNumber = nullptr;
+    m_duration = nullptr;
+    m_sampleRate = nullptr;
+    m_weight = nullptr;
+    m_byArtist = m_byAlbum = m_byTitle = nullptr;
+    m_trigramCount = 0;
+    m_trigramKeys = m_trigramOffsets = m_postings = nullptr;
+}
+
+bool LibraryIndex::load(const std::string& filename) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Failed to open library snapshot: " << filename << std::endl;
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0) {
+        fclose(file);
+        std::cerr << "Empty library snapshot: " << filename << std::endl;
+        return false;
+    }
+
+    // One allocation for the whole library
+    std::vector<uint64_t> snapshot((static_cast<size_t>(size) + 7) / 8, 0);
+    size_t read = fread(snapshot.data(), 1, static_cast<size_t>(size), file);
+    fclose(file);
+    if (read != static_cast<size_t>(size)) {
+        std::cerr << "Failed to read library snapshot: " << filename << std::endl;
+        return false;
+    }
+
+    return adopt(std::move(snapshot));
+}
+
+bool LibraryIndex::save(const std::string& filename) const {
+    if (m_snapshot.empty()) {
+        std::cerr << "Library is empty, nothing to save" << std::endl;
+        return false;
+    }
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to create library snapshot: " << filename << std::endl;
+        return false;
+    }
+    size_t bytes = m_snapshot.size() * sizeof(uint64_t);
+    bool ok = fwrite(m_snapshot.data(), 1, bytes, file) == bytes;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Failed to write library snapshot: " << filename << std::endl;
+    }
+    return ok;
+}
+
+bool LibraryIndex::adopt(std::vector<uint64_t> snapshot) {
+    reset();
+    m_snapshot = std::move(snapshot);
+
+    const size_t bytes = m_snapshot.size() * sizeof(uint64_t);
+    const char* base = reinterpret_cast<const char*>(m_snapshot.data());
+    auto fail = [this](const char* reason) {
+        std::cerr << "Invalid library snapshot: " << reason << std::endl;
+        reset();
+        return false;
+    };
+
+    if (bytes < sizeof(SnapshotHeader)) {
+        return fail("truncated header");
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        return fail("bad magic");
+    }
+    if (header.version != kVersion) {
+        return fail("unsupported version");
+    }
+
+    const uint64_t tracks = header.trackCount;
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        const SectionEntry& section = header.sections[s];
+        uint64_t elementSize = (s == STRING_DATA) ? 1 : 4;
+        if (section.offset % 4 != 0 || section.offset > bytes ||
+            section.count > (bytes - section.offset) / elementSize) {
+            return fail("section out of bounds");
+        }
+
+        uint64_t expected = tracks;
+        switch (s) {
+            case STRING_OFFSETS: expected = uint64_t(header.stringCount) + 1; break;
+            case STRING_DATA:
+            case POSTINGS: expected = section.count; break;
+            case TRIGRAM_KEYS: expected = header.trigramCount; break;
+            case TRIGRAM_OFFSETS: expected = uint64_t(header.trigramCount) + 1; break;
+            default: break;
+        }
+        if (section.count != expected) {
+            return fail("section size mismatch");
+        }
+    }
+
+    auto u32 = [&](Section s) { return reinterpret_cast<const uint32_t*>(base + header.sections[s].offset); };
+    auto f32 = [&](Section s) { return reinterpret_cast<const float*>(base + header.sections[s].offset); };
+
+    const uint32_t* stringOffsets = u32(STRING_OFFSETS);
+    const uint64_t stringBytes = header.sections[STRING_DATA].count;
+    for (uint32_t i = 0; i < header.stringCount; i++) {
+        if (stringOffsets[i] > stringOffsets[i + 1]) return fail("string offsets");
+    }
+    if (stringOffsets[header.stringCount] > stringBytes) return fail("string offsets");
+
+    for (Section s : { PATH, TITLE, ARTIST, ALBUM, GENRE, CODEC }) {
+        const uint32_t* column = u32(s);
+        for (uint64_t t = 0; t < tracks; t++) {
+            if (column[t] >= header.stringCount) return fail("string id out of range");
+        }
+    }
+    for (Section s : { BY_ARTIST, BY_ALBUM, BY_TITLE }) {
+        const uint32_t* order = u32(s);
+        for (uint64_t t = 0; t < tracks; t++) {
+            if (order[t] >= tracks) return fail("track id out of range");
+        }
+    }
+
+    const uint32_t* trigramOffsets = u32(TRIGRAM_OFFSETS);
+    const uint64_t postingCount = header.sections[POSTINGS].count;
+    for (uint32_t i = 0; i < header.trigramCount; i++) {
+        if (trigramOffsets[i] > trigramOffsets[i + 1]) return fail("trigram offsets");
+    }
+    if (trigramOffsets[header.trigramCount] != postingCount) return fail("trigram offsets");
+    const uint32_t* postings = u32(POSTINGS);
+    for (uint64_t i = 0; i < postingCount; i++) {
+        if (postings[i] >= tracks) return fail("posting out of range");
+    }
+
+    m_trackCount = header.trackCount;
+    m_stringCount = header.stringCount;
+    m_stringOffsets = stringOffsets;
+    m_stringData = base + header.sections[STRING_DATA].offset;
+    m_path = u32(PATH);
+    m_title = u32(TITLE);
+    m_artist = u32(ARTIST);
+    m_album = u32(ALBUM);
+    m_genre = u32(GENRE);
+    m_codec = u32(CODEC);
+    m_trackNumber = u32(TRACK_NUMBER);
+    m_duration = f32(DURATION);
+    m_sampleRate = u32(SAMPLE_RATE);
+    m_weight = f32(WEIGHT);
+    m_byArtist = u32(BY_ARTIST);
+    m_byAlbum = u32(BY_ALBUM);
+    m_byTitle = u32(BY_TITLE);
+    m_trigramCount = header.trigramCount;
+    m_trigramKeys = u32(TRIGRAM_KEYS);
+    m_trigramOffsets = trigramOffsets;
+    m_postings = postings;
+    return true;
+}
+
+void LibraryIndex::stringRange(std::string_view text, bool prefix,
+                               uint32_t& first, uint32_t& last) const {
+    auto compare = [&](uint32_t id) {
+        std::string_view value = string(id);
+        if (prefix && value.size() > text.size()) {
+            value = value.substr(0, text.size());
+        }
+        return compareFolded(value, text);
+    };
+
+    uint32_t low = 0, high = m_stringCount;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (compare(mid) < 0) low = mid + 1; else high = mid;
+    }
+    first = low;
+
+    high = m_stringCount;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (compare(mid) <= 0) low = mid + 1; else high = mid;
+    }
+    last = low;
+}
+
+std::vector<uint32_t> LibraryIndex::collectRange(const uint32_t* order, const uint32_t* column,
+                                                 uint32_t first, uint32_t last) const {
+    if (first >= last) {
+        return {};
+    }
+    const uint32_t* begin = std::lower_bound(order, order + m_trackCount, first,
+        [column](uint32_t track, uint32_t id) { return column[track] < id; });
+    const uint32_t* end = std::lower_bound(begin, order + m_trackCount, last,
+        [column](uint32_t track, uint32_t id) { return column[track] < id; });
+    return std::vector<uint32_t>(begin, end);
+}
+
+std::vector<uint32_t> LibraryIndex::findByArtist(std::string_view artist) const {
+    uint32_t first, last;
+    stringRange(artist, false, first, last);
+    return collectRange(m_byArtist, m_artist, first, last);
+}
+
+std::vector<uint32_t> LibraryIndex::findByTitlePrefix(std::string_view prefix) const {
+    uint32_t first, last;
+    stringRange(prefix, true, first, last);
+    return collectRange(m_byTitle, m_title, first, last);
+}
+
+bool LibraryIndex::matchesText(uint32_t track, std::string_view foldedText) const {
+    return containsFolded(title(track), foldedText) ||
+           containsFolded(artist(track), foldedText) ||
+           containsFolded(album(track), foldedText);
+}
+
+std::vector<uint32_t> LibraryIndex::search(std::string_view text) const {
+    std::vector<uint32_t> results;
+    if (text.empty() || m_trackCount == 0) {
+        return results;
+    }
+    std::string folded = foldString(text);
+
+    // Too short for trigrams: scan
+    if (folded.size() < 3) {
+        for (uint32_t t = 0; t < m_trackCount; t++) {
+            if (matchesText(t, folded)) results.push_back(t);
+        }
+        return results;
+    }
+
+    struct Postings { const uint32_t* begin; const uint32_t* end; };
+    std::vector<Postings> lists;
+    for (size_t i = 0; i + 3 <= folded.size(); i++) {
+        uint32_t key = trigramKey(folded.data() + i);
+        const uint32_t* keyEnd = m_trigramKeys + m_trigramCount;
+        const uint32_t* found = std::lower_bound(m_trigramKeys, keyEnd, key);
+        if (found == keyEnd || *found != key) {
+            return results;
+        }
+        size_t slot = found - m_trigramKeys;
+        lists.push_back({ m_postings + m_trigramOffsets[slot], m_postings + m_trigramOffsets[slot + 1] });
+    }
+
+    // Intersect, smallest list first
+    std::sort(lists.begin(), lists.end(), [](const Postings& a, const Postings& b) {
+        return (a.end - a.begin) < (b.end - b.begin);
+    });
+    std::vector<uint32_t> candidates(lists[0].begin, lists[0].end);
+    std::vector<uint32_t> scratch;
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+        scratch.clear();
+        std::set_intersection(candidates.begin(), candidates.end(),
+                              lists[i].begin, lists[i].end, std::back_inserter(scratch));
+        candidates.swap(scratch);
+    }
+
+    // Trigrams may match across non-adjacent positions; confirm
+    for (uint32_t track : candidates) {
+        if (matchesText(track, folded)) results.push_back(track);
+    }
+    return results;
+}
+
+std::vector<uint32_t> LibraryIndex::sortedByAlbum() const {
+    return std::vector<uint32_t>(m_byAlbum, m_byAlbum + m_trackCount);
+}
+
+std::vector<uint32_t> LibraryIndex::shuffle(uint64_t seed, size_t count) const {
+    // Efraimidis-Spirakis: order by an exponential variate scaled by 1/weight
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uniform(std::numeric_limits<double>::min(), 1.0);
+
+    std::vector<std::pair<double, uint32_t>> keys;
+    keys.reserve(m_trackCount);
+    for (uint32_t t = 0; t < m_trackCount; t++) {
+        if (m_weight[t] > 0.0f) {
+            keys.emplace_back(-std::log(uniform(rng)) / m_weight[t], t);
+        }
+    }
+
+    count = std::min(count, keys.size());
+    std::partial_sort(keys.begin(), keys.begin() + count, keys.end());
+
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        order.push_back(keys[i].second);
+    }
+    return order;
+}
@@ -0,0 +1,131 @@
+#ifndef LIBRARYINDEX_H
+#define LIBRARYINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One track as collected while scanning
+struct TrackInfo {
+    std::string path;
+    std::string title;
+    std::string artist;
+    std::string album;
+    std::string genre;
+    std::string codec;
+    uint32_t trackNumber = 0;
+    float duration = 0.0f;   // seconds
+    uint32_t sampleRate = 0;
+    float weight = 1.0f;     // relative shuffle weight
+};
+
+// Collects tracks and produces the compact snapshot a LibraryIndex serves
+// queries from. Building is the only step that allocates per track.
+class LibraryBuilder {
+public:
+    void add(const TrackInfo& track);
+
+    // Probes one file with the player's demux/decoder setup
+    bool addFile(const std::string& path);
+
+    // Recursively adds every file with a known audio extension
+    size_t scanDirectory(const std::string& directory);
+
+    size_t size() const { return m_tracks.size(); }
+
+    // True for the extensions scanDirectory picks up
+    static bool isAudioFile(const std::string& path);
+
+    // Serialized snapshot (see LibraryIndex), 8-byte aligned
+    std::vector<uint64_t> build() const;
+
+private:
+    std::vector<TrackInfo> m_tracks;
+};
+
+// Read-only columnar track index. All strings are interned into one pool
+// whose ids are assigned in case-folded order, so equality and prefix
+// queries become id ranges and the sorted secondary indexes are plain id
+// permutations. Substring search goes through a trigram index.
+//
+// The in-memory form is the on-disk snapshot: load() reads the file into a
+// single buffer and every column is a view into it.
+class LibraryIndex {
+public:
+    LibraryIndex();
+
+    bool load(const std::string& filename);
+    bool save(const std::string& filename) const;
+    bool adopt(std::vector<uint64_t> snapshot);
+
+    size_t size() const { return m_trackCount; }
+    bool empty() const { return m_trackCount == 0; }
+
+    std::string_view path(uint32_t track) const { return string(m_path[track]); }
+    std::string_view title(uint32_t track) const { return string(m_title[track]); }
+    std::string_view artist(uint32_t track) const { return string(m_artist[track]); }
+    std::string_view album(uint32_t track) const { return string(m_album[track]); }
+    std::string_view genre(uint32_t track) const { return string(m_genre[track]); }
+    std::string_view codec(uint32_t track) const { return string(m_codec[track]); }
+    uint32_t trackNumber(uint32_t track) const { return m_trackNumber[track]; }
+    float duration(uint32_t track) const { return m_duration[track]; }
+    uint32_t sampleRate(uint32_t track) const { return m_sampleRate[track]; }
+
+    // Case-insensitive exact artist match, ordered by album and track
+    std::vector<uint32_t> findByArtist(std::string_view artist) const;
+
+    // Case-insensitive title prefix, ordered by title
+    std::vector<uint32_t> findByTitlePrefix(std::string_view prefix) const;
+
+    // Case-insensitive substring of title, artist or album
+    std::vector<uint32_t> search(std::string_view text) const;
+
+    // Every track ordered by album, then track number
+    std::vector<uint32_t> sortedByAlbum() const;
+
+    // Weighted random order (heavier tracks tend to come first)
+    std::vector<uint32_t> shuffle(uint64_t seed, size_t count) const;
+
+private:
+    std::string_view string(uint32_t id) const {
+        return std::string_view(m_stringData + m_stringOffsets[id],
+                                m_stringOffsets[id + 1] - m_stringOffsets[id]);
+    }
+
+    // Ids whose folded string equals (or starts with) the folded text
+    void stringRange(std::string_view text, bool prefix, uint32_t& first, uint32_t& last) const;
+    std::vector<uint32_t> collectRange(const uint32_t* order, const uint32_t* column,
+                                       uint32_t first, uint32_t last) const;
+    bool matchesText(uint32_t track, std::string_view foldedText) const;
+    void reset();
+
+    std::vector<uint64_t> m_snapshot;
+
+    // 指向快照内部的列视图
+    uint32_t m_trackCount;
+    uint32_t m_stringCount;
+    const uint32_t* m_stringOffsets;
+    const char* m_stringData;
+    const uint32_t* m_path;
+    const uint32_t* m_title;
+    const uint32_t* m_artist;
+    const uint32_t* m_album;
+    const uint32_t* m_genre;
+    const uint32_t* m_codec;
+    const uint32_t* m_trackNumber;
+    const float* m_duration;
+    const uint32_t* m_sampleRate;
+    const float* m_weight;
+
+    // 二级索引
+    const uint32_t* m_byArtist;
+    const uint32_t* m_byAlbum;
+    const uint32_t* m_byTitle;
+    uint32_t m_trigramCount;
+    const uint32_t* m_trigramKeys;
+    const uint32_t* m_trigramOffsets;
+    const uint32_t* m_postings;
+};
+
+#endif // LIBRARYINDEX_H
@@ -0,0 +1,190 @@
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// Marks the calling thread's ring as retired when the thread exits so the
+// writer can free it once drained.
+struct LoggerThreadRing {
+    Logger::Ring* ring = nullptr;
+
+    ~LoggerThreadRing() {
+        if (ring) {
+            ring->retired.store(true, std::memory_order_release);
+        }
+    }
+};
+
+static thread_local LoggerThreadRing t_threadRing;
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : m_level(MUSICWAVE_LOG_LEVEL)
+    , m_sequence(0)
+    , m_dropped(0)
+    , m_passCount(0)
+    , m_wakeRequested(false)
+    , m_shouldStop(false)
+{
+    m_batch.reserve(RING_SIZE * 4);
+    m_writerThread = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_shouldStop = true;
+    }
+    m_writerCondition.notify_one();
+
+    if (m_writerThread.joinable()) {
+        m_writerThread.join();
+    }
+}
+
+void Logger::setLevel(LogLevel level) {
+    m_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel() const {
+    return static_cast<LogLevel>(m_level.load(std::memory_order_relaxed));
+}
+
+uint64_t Logger::getDroppedCount() const {
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+Logger::Ring* Logger::threadRing() {
+    if (!t_threadRing.ring) {
+        // Once per thread; the ring is owned by the logger from here on
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        m_rings.push_back(std::make_unique<Ring>());
+        t_threadRing.ring = m_rings.back().get();
+    }
+    return t_threadRing.ring;
+}
+
+void Logger::log(LogLevel level, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vlog(level, fmt, args);
+    va_end(args);
+}
+
+void Logger::vlog(LogLevel level, const char* fmt, va_list args) {
+    if (!isEnabled(level) || !fmt) {
+        return;
+    }
+
+    Ring* ring = threadRing();
+    uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint32_t head = ring->head.load(std::memory_order_acquire);
+    if (tail - head >= RING_SIZE) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& record = ring->records[tail % RING_SIZE];
+    int written = vsnprintf(record.text, MAX_MESSAGE, fmt, args);
+    if (written < 0) {
+        return;
+    }
+
+    record.length = std::min<uint32_t>(static_cast<uint32_t>(written), MAX_MESSAGE - 1);
+    record.level = level;
+    record.sequence = m_sequence.fetch_add(1, std::memory_order_relaxed);
+    ring->tail.store(tail + 1, std::memory_order_release);
+}
+
+bool Logger::drainOnce() {
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        for (auto it = m_rings.begin(); it != m_rings.end();) {
+            Ring* ring = it->get();
+            // Read the flag first: once set, nothing more can be appended
+            bool retired = ring->retired.load(std::memory_order_acquire);
+            uint32_t head = ring->head.load(std::memory_order_relaxed);
+            uint32_t tail = ring->tail.load(std::memory_order_acquire);
+
+            for (; head != tail; head++) {
+                m_batch.push_back(ring->records[head % RING_SIZE]);
+            }
+            ring->head.store(head, std::memory_order_release);
+
+            if (retired) {
+                it = m_rings.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    if (m_batch.empty()) {
+        return false;
+    }
+
+    // Restore cross-thread ordering
+    std::sort(m_batch.begin(), m_batch.end(), [](const Record& a, const Record& b) {
+        return a.sequence < b.sequence;
+    });
+
+    bool wroteErrors = false;
+    bool wroteOutput = false;
+    for (const auto& record : m_batch) {
+        bool isError = record.level <= LogLevel::Warning;
+        FILE* stream = isError ? stderr : stdout;
+        fwrite(record.text, 1, record.length, stream);
+        if (record.length == 0 || record.text[record.length - 1] != '\n') {
+            fputc('\n', stream);
+        }
+        wroteErrors |= isError;
+        wroteOutput |= !isError;
+    }
+
+    if (wroteOutput) fflush(stdout);
+    if (wroteErrors) fflush(stderr);
+
+    m_batch.clear();
+    return true;
+}
+
+void Logger::writerLoop() {
+    while (true) {
+        bool drained = drainOnce();
+
+        std::unique_lock<std::mutex> lock(m_writerMutex);
+        m_passCount++;
+        m_flushCondition.notify_all();
+
+        if (m_shouldStop && !drained) {
+            break;
+        }
+
+        if (!drained) {
+            // Producers never signal, so poll at a short interval
+            m_writerCondition.wait_for(lock, std::chrono::milliseconds(10), [this] {
+                return m_wakeRequested || m_shouldStop;
+            });
+        }
+        m_wakeRequested = false;
+    }
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(m_writerMutex);
+    if (m_shouldStop) {
+        return;
+    }
+
+    // Two passes guarantee one full drain started after this call
+    uint64_t target = m_passCount + 2;
+    m_wakeRequested = true;
+    m_writerCondition.notify_one();
+    m_flushCondition.wait(lock, [this, target] {
+        return m_passCount >= target || m_shouldStop;
+    });
+}
@@ -0,0 +1,117 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class LogLevel : int {
+    Error = 0,
+    Warning = 1,
+    Info = 2,
+    Debug = 3
+};
+
+// Calls above this level compile to nothing. Debug builds keep everything.
+#ifndef MUSICWAVE_LOG_LEVEL
+#ifdef DEBUG
+#define MUSICWAVE_LOG_LEVEL 3
+#else
+#define MUSICWAVE_LOG_LEVEL 2
+#endif
+#endif
+
+// Asynchronous logger for real-time threads. Each producing thread formats
+// into a slot of its own fixed-size single-producer ring, so logging never
+// locks, allocates or touches the terminal; a background thread writes the
+// finished records out. When a ring is full the record is dropped.
+class Logger {
+public:
+    static constexpr size_t MAX_MESSAGE = 240;
+    static constexpr uint32_t RING_SIZE = 256;
+
+    static Logger& instance();
+
+    void setLevel(LogLevel level);
+    LogLevel getLevel() const;
+    bool isEnabled(LogLevel level) const {
+        return static_cast<int>(level) <= m_level.load(std::memory_order_relaxed);
+    }
+
+    void log(LogLevel level, const char* fmt, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 3, 4)))
+#endif
+        ;
+    void vlog(LogLevel level, const char* fmt, va_list args);
+
+    // Blocks until everything logged before the call has been written
+    void flush();
+
+    uint64_t getDroppedCount() const;
+
+private:
+    struct Record {
+        uint64_t sequence;
+        LogLevel level;
+        uint32_t length;
+        char text[MAX_MESSAGE];
+    };
+
+    struct Ring {
+        Record records[RING_SIZE];
+        std::atomic<uint32_t> head{0};  // 写线程读取位置
+        std::atomic<uint32_t> tail{0};  // 生产线程写入位置
+        std::atomic<bool> retired{false};
+    };
+
+    friend struct LoggerThreadRing;
+
+    Logger();
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    Ring* threadRing();
+    void writerLoop();
+    bool drainOnce();
+
+    std::atomic<int> m_level;
+    std::atomic<uint64_t> m_sequence;
+    std::atomic<uint64_t> m_dropped;
+
+    // 每线程环形缓冲区（仅在线程首次写日志时加锁注册）
+    std::mutex m_ringsMutex;
+    std::vector<std::unique_ptr<Ring>> m_rings;
+
+    // 后台写线程
+    std::thread m_writerThread;
+    std::mutex m_writerMutex;
+    std::condition_variable m_writerCondition;
+    std::condition_variable m_flushCondition;
+    uint64_t m_passCount;
+    bool m_wakeRequested;
+    bool m_shouldStop;
+
+    std::vector<Record> m_batch;
+};
+
+#define MW_LOG(level, ...)                                                        \
+    do {                                                                          \
+        if (static_cast<int>(level) <= MUSICWAVE_LOG_LEVEL &&                     \
+            Logger::instance().isEnabled(level)) {                                \
+            Logger::instance().log(level, __VA_ARGS__);                           \
+        }                                                                         \
+    } while (0)
+
+#define LOG_ERROR(...) MW_LOG(LogLevel::Error, __VA_ARGS__)
+#define LOG_WARNING(...) MW_LOG(LogLevel::Warning, __VA_ARGS__)
+#define LOG_INFO(...) MW_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_DEBUG(...) MW_LOG(LogLevel::Debug, __VA_ARGS__)
+
+#endif // LOGGER_H
@@ -1,4 +1,7 @@
 #include "MusicPlayer.h"
+#include "Logger.h"
+#include "SpectrumAnalyzer.h"
+#include "StreamServer.h"
 #include <iostream>
 #include <algorithm>
 #include <cstring>
@@ -6,11 +9,46 @@
 #include <cstdarg>
 #include <vector>
 
+namespace {
+
+// SDL2's channel order for each channel count (see SDL_AudioSpec)
+void sdlChannelLayout(int channels, AVChannelLayout& layout) {
+    uint64_t mask = 0;
+    switch (channels) {
+        case 1: mask = AV_CH_LAYOUT_MONO; break;
+        case 2: mask = AV_CH_LAYOUT_STEREO; break;
+        case 3: mask = AV_CH_LAYOUT_2POINT1; break;
+        case 4: mask = AV_CH_LAYOUT_QUAD; break;
+        case 5: mask = AV_CH_LAYOUT_QUAD | AV_CH_LOW_FREQUENCY; break;
+        case 6: mask = AV_CH_LAYOUT_5POINT1; break;
+        case 7: mask = AV_CH_LAYOUT_6POINT1; break;
+        case 8: mask = AV_CH_LAYOUT_7POINT1; break;
+        default:
+            av_channel_layout_default(&layout, channels);
+            return;
+    }
+    av_channel_layout_from_mask(&layout, mask);
+}
+
+std::string describeLayout(const AVChannelLayout& layout) {
+    char name[64];
+    if (av_channel_layout_describe(&layout, name, sizeof(name)) < 0) {
+        return std::to_string(layout.nb_channels) + " channels";
+    }
+    return name;
+}
+
+} // namespace
+
 MusicPlayer::MusicPlayer() 
     : m_formatContext(nullptr)
     , m_codecContext(nullptr)
     , m_swrContext(nullptr)
     , m_audioStream(nullptr)
+    , m_convertKernel(nullptr)
+    , m_useMatrix(false)
+    , m_matrixDirect(false)
+    , m_matrixCapacity(0)
     , m_audioDevice(0)
     , m_state(State::STOPPED)
     , m_volume(1.0f)
@@ -18,6 +56,8 @@ MusicPlayer::MusicPlayer()
     , m_seekRequested(false)
     , m_seekTime(0.0)
     , m_shouldStop(false)
+    , m_analyzer(nullptr)
+    , m_streamServer(nullptr)
     , m_duration(0.0)
     , m_audioStreamIndex(-1)
 {
@@ -29,27 +69,31 @@ MusicPlayer::~MusicPlayer() {
     stop();
     cleanup();
     SDL_Quit();
+    Logger::instance().flush();
 }
 
 bool MusicPlayer::initializeFFmpeg() {
     // Set FFmpeg log level to reduce noise from MP3 timestamp warnings
     av_log_set_level(AV_LOG_WARNING);
     
-    // Custom log callback to filter out specific warnings
+    // Custom log callback to filter out specific warnings. FFmpeg calls this
+    // from the decoding thread, so filter on the raw format string and hand
+    // the message to the async logger instead of writing to stderr here.
     av_log_set_callback([](void* avcl, int level, const char* fmt, va_list vl) {
-        // Skip the annoying MP3 timestamp warnings
-        if (level <= AV_LOG_WARNING && fmt) {
-            std::string msg(fmt);
-            if (msg.find("Could not update timestamps for skipped samples") != std::string::npos ||
-                msg.find("Could not update timestamps for discarded samples") != std::string::npos) {
-                return; // Skip this warning
-            }
+        (void)avcl;
+        
+        // Only errors are shown
+        if (level > AV_LOG_ERROR || !fmt) {
+            return;
         }
         
-        // For other messages, use default behavior but only for errors
-        if (level <= AV_LOG_ERROR) {
-            vfprintf(stderr, fmt, vl);
+        // Skip the annoying MP3 timestamp warnings
+        if (strstr(fmt, "Could not update timestamps for skipped samples") ||
+            strstr(fmt, "Could not update timestamps for discarded samples")) {
+            return; // Skip this warning
         }
+        
+        Logger::instance().vlog(LogLevel::Error, fmt, vl);
     });
     
     // Initialize FFmpeg network (av_register_all() is deprecated in FFmpeg 4.0+)
@@ -114,72 +158,16 @@ bool MusicPlayer::loadFile(const std::string& filename) {
     stop();
     cleanup();
     
-    m_formatContext = avformat_alloc_context();
-    if (!m_formatContext) {
-        std::cerr << "Failed to allocate format context" << std::endl;
-        return false;
-    }
-    
-    // Open input file
-    if (avformat_open_input(&m_formatContext, filename.c_str(), nullptr, nullptr) != 0) {
-        std::cerr << "Failed to open input file: " << filename << std::endl;
-        return false;
-    }
-    
-    // Retrieve stream information
-    if (avformat_find_stream_info(m_formatContext, nullptr) < 0) {
-        std::cerr << "Failed to find stream information" << std::endl;
-        return false;
-    }
-    
-    // Find audio stream
-    m_audioStreamIndex = -1;
-    for (unsigned int i = 0; i < m_formatContext->nb_streams; i++) {
-        if (m_formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-            m_audioStreamIndex = i;
-            break;
-        }
-    }
-    
-    if (m_audioStreamIndex == -1) {
-        std::cerr << "No audio stream found" << std::endl;
+    AudioInput input;
+    if (!openAudioInput(filename, input)) {
         return false;
     }
     
-    m_audioStream = m_formatContext->streams[m_audioStreamIndex];
-    
-    // Get codec
-    const AVCodec* codec = avcodec_find_decoder(m_audioStream->codecpar->codec_id);
-    if (!codec) {
-        std::cerr << "Codec not found" << std::endl;
-        return false;
-    }
-    
-    // Allocate codec context
-    m_codecContext = avcodec_alloc_context3(codec);
-    if (!m_codecContext) {
-        std::cerr << "Failed to allocate codec context" << std::endl;
-        return false;
-    }
-    
-    // Copy codec parameters
-    if (avcodec_parameters_to_context(m_codecContext, m_audioStream->codecpar) < 0) {
-        std::cerr << "Failed to copy codec parameters" << std::endl;
-        return false;
-    }
-    
-    // Open codec
-    if (avcodec_open2(m_codecContext, codec, nullptr) < 0) {
-        std::cerr << "Failed to open codec" << std::endl;
-        return false;
-    }
-    
-    // Calculate duration
-    if (m_formatContext->duration != AV_NOPTS_VALUE) {
-        m_duration = (double)m_formatContext->duration / AV_TIME_BASE;
-    } else {
-        m_duration = 0.0;
-    }
+    m_formatContext = input.formatContext;
+    m_codecContext = input.codecContext;
+    m_audioStream = input.stream;
+    m_audioStreamIndex = input.streamIndex;
+    m_duration = input.duration;
     
     // Setup audio conversion
     if (!setupAudioConversion()) {
@@ -191,12 +179,25 @@ bool MusicPlayer::loadFile(const std::string& filename) {
 }
 
 bool MusicPlayer::setupAudioConversion() {
+    // Streams without a channel map get FFmpeg's default for their count
+    AVChannelLayout in_ch_layout = m_codecContext->ch_layout;
+    if (in_ch_layout.order == AV_CHANNEL_ORDER_UNSPEC) {
+        av_channel_layout_default(&in_ch_layout, in_ch_layout.nb_channels);
+    }
+    
+    // Ask for the source's channels (SDL2 handles up to 8); SDL may answer
+    // with a different count, and the output layout follows what it opened
+    int wantedChannels = std::min(in_ch_layout.nb_channels, 8);
+    if (m_outputOptions.maxChannels > 0) {
+        wantedChannels = std::min(wantedChannels, m_outputOptions.maxChannels);
+    }
+    
     // Setup SDL audio specification
     SDL_AudioSpec wanted, obtained;
     SDL_zero(wanted);
     wanted.freq = m_codecContext->sample_rate;
     wanted.format = AUDIO_S16SYS;
-    wanted.channels = m_codecContext->ch_layout.nb_channels;
+    wanted.channels = static_cast<Uint8>(wantedChannels);
     wanted.samples = 2048;  // Even smaller buffer for testing
     wanted.callback = nullptr;  // Use SDL_QueueAudio instead of callback
     wanted.userdata = nullptr;
@@ -305,6 +306,34 @@ bool MusicPlayer::setupAudioConversion() {
         return false;
     }
     
+    AVChannelLayout out_ch_layout;
+    sdlChannelLayout(m_audioSpec.channels, out_ch_layout);
+    
+    // Bypass swr for the common format pairs when the rate is unchanged and
+    // the layout is either identical or a mono upmix
+    bool sameLayout = av_channel_layout_compare(&in_ch_layout, &out_ch_layout) == 0;
+    m_convertKernel = nullptr;
+    if (m_audioSpec.freq == m_codecContext->sample_rate) {
+        bool monoUpmix = in_ch_layout.nb_channels == 1 && out_ch_layout.nb_channels == 2;
+        if (sameLayout || monoUpmix) {
+            m_convertKernel = SampleConvert::findKernel(m_codecContext->sample_fmt,
+                                                        in_ch_layout.nb_channels,
+                                                        out_ch_layout.nb_channels);
+        }
+    }
+    
+    // Any other layout change goes through the channel matrix. swr then
+    // keeps the source layout and only converts to planar float at the
+    // device rate, which is skipped entirely when the decoder already
+    // produces exactly that.
+    m_useMatrix = !sameLayout && !m_convertKernel &&
+                  m_channelMatrix.build(in_ch_layout, out_ch_layout, m_outputOptions.gains);
+    m_matrixDirect = m_useMatrix && m_codecContext->sample_fmt == AV_SAMPLE_FMT_FLTP &&
+                     m_audioSpec.freq == m_codecContext->sample_rate;
+    
+    const AVChannelLayout* swr_out_layout = m_useMatrix ? &in_ch_layout : &out_ch_layout;
+    AVSampleFormat swr_out_format = m_useMatrix ? AV_SAMPLE_FMT_FLTP : AV_SAMPLE_FMT_S16;
+    
     // Setup resampling context
     m_swrContext = swr_alloc();
     if (!m_swrContext) {
@@ -312,14 +341,10 @@ bool MusicPlayer::setupAudioConversion() {
         return false;
     }
     
-    // Create proper channel layout variables
-    AVChannelLayout out_ch_layout = AV_CHANNEL_LAYOUT_STEREO;
-    AVChannelLayout in_ch_layout = m_codecContext->ch_layout;
-    
     // Set resampling options for newer FFmpeg with channel layout support
     int ret = swr_alloc_set_opts2(&m_swrContext,
-                                  &out_ch_layout,                    // out_ch_layout
-                                  AV_SAMPLE_FMT_S16,                 // out_sample_fmt
+                                  swr_out_layout,                    // out_ch_layout
+                                  swr_out_format,                    // out_sample_fmt
                                   m_audioSpec.freq,                  // out_sample_rate
                                   &in_ch_layout,                     // in_ch_layout
                                   m_codecContext->sample_fmt,        // in_sample_fmt
@@ -336,6 +361,45 @@ bool MusicPlayer::setupAudioConversion() {
         return false;
     }
     
+    if (m_useMatrix && !m_matrixDirect) {
+        allocateMatrixPlanes(8192);
+    }
+    
+    m_outputDescription = describeLayout(in_ch_layout) + " -> " + describeLayout(out_ch_layout);
+    m_matrixDescription.clear();
+    if (m_useMatrix) {
+        m_outputDescription += " (channel matrix)";
+        m_matrixDescription = m_channelMatrix.describe(in_ch_layout, out_ch_layout);
+    } else if (m_convertKernel) {
+        m_outputDescription += " (conversion kernel)";
+    } else {
+        m_outputDescription += " (swr)";
+    }
+    
+    if (m_convertKernel) {
+        std::cout << "Using specialized conversion kernel for "
+                  << av_get_sample_fmt_name(m_codecContext->sample_fmt) << std::endl;
+    }
+    if (m_useMatrix) {
+        std::cout << "Using channel matrix for " << m_outputDescription << std::endl;
+    }
+    
+    // Allocate DSP state up front so the decoding thread never has to
+    m_dspChain.prepare(m_audioSpec.freq, m_audioSpec.channels);
+    m_timeStretch.prepare(m_audioSpec.freq, m_audioSpec.channels);
+    m_dspBuffer.assign(static_cast<size_t>(m_timeStretch.maxOutputFrames()) * m_audioSpec.channels, 0.0f);
+    
+    if (SpectrumAnalyzer* analyzer = m_analyzer.load()) {
+        analyzer->setSampleRate(m_audioSpec.freq);
+    }
+    // The LAN stream is stereo; wider device layouts fold down the same way
+    AVChannelLayout stereo = AV_CHANNEL_LAYOUT_STEREO;
+    m_streamDownmix.build(out_ch_layout, stereo, m_outputOptions.gains);
+    if (StreamServer* server = m_streamServer.load()) {
+        server->setSampleRate(m_audioSpec.freq);
+        server->setDownmix(m_streamDownmix);
+    }
+    
     return true;
 }
 
@@ -354,6 +418,11 @@ bool MusicPlayer::play() {
         return true;
     }
     
+    // A thread that ended at end of file has exited but was never joined
+    if (m_decodingThread.joinable()) {
+        m_decodingThread.join();
+    }
+    
     // Start decoding thread
     m_shouldStop.store(false);
     m_state.store(State::PLAYING);
@@ -376,6 +445,10 @@ bool MusicPlayer::pause() {
 
 bool MusicPlayer::stop() {
     if (m_state.load() == State::STOPPED) {
+        // The decoding thread stops itself at end of file
+        if (m_decodingThread.joinable()) {
+            m_decodingThread.join();
+        }
         return true;
     }
     
@@ -413,14 +486,20 @@ void MusicPlayer::decodingLoop() {
     AVFrame* frame = av_frame_alloc();
     
     if (!frame) {
-        std::cerr << "Failed to allocate frame in decoding loop" << std::endl;
+        LOG_ERROR("Failed to allocate frame in decoding loop");
         return;
     }
     
-    std::cout << "Decoding thread started (using SDL_QueueAudio)" << std::endl;
+    LOG_INFO("Decoding thread started (using SDL_QueueAudio)");
+    
+    m_timeStretch.reset();
 
     bool deviceStarted = false;
     
+    // Queue limits in bytes of the opened format, whatever its channel count
+    const Uint32 bytesPerSecond = m_audioSpec.freq * m_audioSpec.channels * sizeof(int16_t);
+    const Uint32 MAX_QUEUED_BYTES = bytesPerSecond * 3; // ~3 seconds
+    
     while (!m_shouldStop.load()) {
         // Handle seek requests
         if (m_seekRequested.load()) {
@@ -430,6 +509,8 @@ void MusicPlayer::decodingLoop() {
             
             // Clear SDL audio queue
             SDL_ClearQueuedAudio(m_audioDevice);
+            m_dspChain.reset();
+            m_timeStretch.reset();
             
             m_currentTime.store(m_seekTime.load());
             m_seekRequested.store(false);
@@ -437,7 +518,6 @@ void MusicPlayer::decodingLoop() {
         
         // Check SDL audio queue size - don't let it get too full
         Uint32 queuedBytes = SDL_GetQueuedAudioSize(m_audioDevice);
-        const Uint32 MAX_QUEUED_BYTES = 44100 * 2 * 2 * 3; // ~3 seconds
         
         if (queuedBytes > MAX_QUEUED_BYTES) {
             // Queue is full, wait a bit
@@ -451,7 +531,12 @@ void MusicPlayer::decodingLoop() {
         int ret = av_read_frame(m_formatContext, &packet);
         if (ret < 0) {
             if (ret == AVERROR_EOF) {
-                std::cout << "End of file reached" << std::endl;
+                LOG_INFO("End of file reached");
+                // The stretcher still holds up to a window of input
+                int16_t* tail = nullptr;
+                int tailFrames = m_timeStretch.flush(&tail);
+                queueSamples(tail, tailFrames);
+
                 // Wait for audio queue to empty before stopping
                 while (SDL_GetQueuedAudioSize(m_audioDevice) > 0 && !m_shouldStop.load()) {
                     std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -485,28 +570,26 @@ void MusicPlayer::decodingLoop() {
                 int outputSize = 0;
                 
                 if (decodeAudioFrame(frame, &output, &outputSize) > 0) {
-                    // Apply volume
-                    float vol = m_volume.load();
-                    if (vol < 0.99f) {
-                        int16_t* samples = reinterpret_cast<int16_t*>(output);
-                        int sampleCount = outputSize / sizeof(int16_t);
-                        for (int i = 0; i < sampleCount; i++) {
-                            samples[i] = static_cast<int16_t>(samples[i] * vol);
-                        }
-                    }
-                    
-                    // Queue audio data directly to SDL
-                    if (SDL_QueueAudio(m_audioDevice, output, outputSize) < 0) {
-                        std::cerr << "Failed to queue audio: " << SDL_GetError() << std::endl;
+                    // Stretch first so DSP, volume and the taps see output-rate audio;
+                    // the stretcher may hold everything back while its window fills
+                    int channels = m_audioSpec.channels;
+                    int16_t* decoded = reinterpret_cast<int16_t*>(output);
+                    int decodedFrames = outputSize / (sizeof(int16_t) * channels);
+                    for (int offset = 0; offset < decodedFrames; offset += TimeStretch::MAX_BLOCK) {
+                        int16_t* samples = decoded + static_cast<size_t>(offset) * channels;
+                        int frames = m_timeStretch.process(
+                            samples, std::min(TimeStretch::MAX_BLOCK, decodedFrames - offset), &samples);
+                        queueSamples(samples, frames);
                     }
 
                     //Save for a second
-                    if (!deviceStarted && SDL_GetQueuedAudioSize(m_audioDevice) > 176400) {
+                    if (!deviceStarted && SDL_GetQueuedAudioSize(m_audioDevice) > bytesPerSecond) {
                         SDL_PauseAudioDevice(m_audioDevice, 0);
                         deviceStarted = true;
                     }
                     
-                    // Update timestamp
+                    // Update timestamp. Stream timestamps are media time, so the clock
+                    // runs at the playback speed without any correction.
                     double frameTime = 0.0;
                     if (packet.pts != AV_NOPTS_VALUE) {
                         frameTime = packet.pts * av_q2d(m_audioStream->time_base);
@@ -525,8 +608,8 @@ void MusicPlayer::decodingLoop() {
                     
                     static int frameCount = 0;
                     if (++frameCount % 100 == 0) {
-                        std::cout << "Queued " << frameCount << " frames, SDL queue: " 
-                                  << SDL_GetQueuedAudioSize(m_audioDevice) << " bytes" << std::endl;
+                        LOG_DEBUG("Queued %d frames, SDL queue: %u bytes",
+                                  frameCount, SDL_GetQueuedAudioSize(m_audioDevice));
                     }
                 }
             }
@@ -535,11 +618,63 @@ void MusicPlayer::decodingLoop() {
         av_packet_unref(&packet);
     }
     
-    std::cout << "Decoding thread finished" << std::endl;
+    LOG_INFO("Decoding thread finished");
     av_frame_free(&frame);
 }
 
 int MusicPlayer::decodeAudioFrame(AVFrame* frame, uint8_t** output, int* outputSize) {
+    if (m_useMatrix) {
+        const float* const* planes = reinterpret_cast<const float* const*>(frame->extended_data);
+        int frames = frame->nb_samples;
+        
+        if (!m_matrixDirect) {
+            int capacity = swr_get_out_samples(m_swrContext, frame->nb_samples);
+            if (capacity > m_matrixCapacity) {
+                // Sized for the stretcher's largest output at setup, so this never grows
+    // on the decoding thread; kept for safety
+                allocateMatrixPlanes(capacity);
+            }
+            frames = swr_convert(m_swrContext, m_matrixPlanes.data(), m_matrixCapacity,
+                                 (const uint8_t**)frame->extended_data, frame->nb_samples);
+            if (frames <= 0) {
+                return 0;
+            }
+            planes = reinterpret_cast<const float* const*>(m_matrixPlanes.data());
+        }
+        
+        int outputBufferSize = av_samples_get_buffer_size(nullptr, m_audioSpec.channels,
+                                                          frames, AV_SAMPLE_FMT_S16, 1);
+        if (outputBufferSize <= 0) {
+            return 0;
+        }
+        
+        *output = (uint8_t*)av_malloc(outputBufferSize);
+        if (!*output) {
+            return 0;
+        }
+        
+        m_channelMatrix.process(planes, reinterpret_cast<int16_t*>(*output), frames);
+        *outputSize = outputBufferSize;
+        return frames;
+    }
+    
+    if (m_convertKernel) {
+        int outputBufferSize = av_samples_get_buffer_size(nullptr, m_audioSpec.channels,
+                                                          frame->nb_samples, AV_SAMPLE_FMT_S16, 1);
+        if (outputBufferSize <= 0) {
+            return 0;
+        }
+        
+        *output = (uint8_t*)av_malloc(outputBufferSize);
+        if (!*output) {
+            return 0;
+        }
+        
+        m_convertKernel(frame->extended_data, reinterpret_cast<int16_t*>(*output), frame->nb_samples);
+        *outputSize = outputBufferSize;
+        return frame->nb_samples;
+    }
+    
     int outputSamples = swr_get_out_samples(m_swrContext, frame->nb_samples);
     if (outputSamples <= 0) {
         return 0;
@@ -567,6 +702,62 @@ int MusicPlayer::decodeAudioFrame(AVFrame* frame, uint8_t** output, int* outputS
     return convertedSamples;
 }
 
+void MusicPlayer::allocateMatrixPlanes(int frames) {
+    const int channels = m_channelMatrix.inputChannels();
+    m_matrixCapacity = frames;
+    m_matrixBuffer.assign(static_cast<size_t>(frames) * channels, 0.0f);
+    m_matrixPlanes.resize(channels);
+    for (int c = 0; c < channels; c++) {
+        m_matrixPlanes[c] = reinterpret_cast<uint8_t*>(m_matrixBuffer.data() + static_cast<size_t>(c) * frames);
+    }
+}
+
+void MusicPlayer::processDsp(int16_t* samples, int sampleCount) {
+    // Sized for the stretcher's largest output at setup, so this never grows
+    // on the decoding thread; kept for safety
+    if (m_dspBuffer.size() < static_cast<size_t>(sampleCount)) {
+        m_dspBuffer.resize(sampleCount);
+    }
+    
+    float* buffer = m_dspBuffer.data();
+    SampleConvert::toFloat(samples, buffer, sampleCount);
+    m_dspChain.process(buffer, sampleCount / m_audioSpec.channels);
+    SampleConvert::toS16(buffer, samples, sampleCount);
+}
+
+void MusicPlayer::queueSamples(int16_t* samples, int frames) {
+    if (frames <= 0) {
+        return;
+    }
+    int channels = m_audioSpec.channels;
+    int sampleCount = frames * channels;
+
+    if (!m_dspChain.empty()) {
+        processDsp(samples, sampleCount);
+    }
+
+    // Apply volume
+    float vol = m_volume.load();
+    if (vol < 0.99f) {
+        for (int i = 0; i < sampleCount; i++) {
+            samples[i] = static_cast<int16_t>(samples[i] * vol);
+        }
+    }
+
+    // Hand copies to the analyzer and the stream; neither blocks
+    if (SpectrumAnalyzer* analyzer = m_analyzer.load(std::memory_order_acquire)) {
+        analyzer->push(samples, frames, channels);
+    }
+    if (StreamServer* server = m_streamServer.load(std::memory_order_acquire)) {
+        server->push(samples, frames, channels);
+    }
+
+    // Queue audio data directly to SDL
+    if (SDL_QueueAudio(m_audioDevice, samples, sampleCount * sizeof(int16_t)) < 0) {
+        LOG_ERROR("Failed to queue audio: %s", SDL_GetError());
+    }
+}
+
 // SDL_QueueAudio approach - no callback needed
 void MusicPlayer::setVolume(float volume) {
     m_volume.store(std::max(0.0f, std::min(1.0f, volume)));
@@ -576,6 +767,14 @@ float MusicPlayer::getVolume() const {
     return m_volume.load();
 }
 
+void MusicPlayer::setSpeed(float speed) {
+    m_timeStretch.setSpeed(speed);
+}
+
+float MusicPlayer::getSpeed() const {
+    return m_timeStretch.getSpeed();
+}
+
 double MusicPlayer::getCurrentTime() const {
     return m_currentTime.load();
 }
@@ -592,6 +791,41 @@ std::string MusicPlayer::getCurrentFile() const {
     return m_currentFile;
 }
 
+DspChain& MusicPlayer::getDspChain() {
+    return m_dspChain;
+}
+
+void MusicPlayer::setAnalyzer(SpectrumAnalyzer* analyzer) {
+    if (analyzer && m_audioDevice) {
+        analyzer->setSampleRate(m_audioSpec.freq);
+    }
+    m_analyzer.store(analyzer, std::memory_order_release);
+}
+
+void MusicPlayer::setStreamServer(StreamServer* server) {
+    if (server && m_audioDevice) {
+        server->setSampleRate(m_audioSpec.freq);
+        server->setDownmix(m_streamDownmix);
+    }
+    m_streamServer.store(server, std::memory_order_release);
+}
+
+void MusicPlayer::setOutputOptions(const OutputOptions& options) {
+    m_outputOptions = options;
+}
+
+const MusicPlayer::OutputOptions& MusicPlayer::getOutputOptions() const {
+    return m_outputOptions;
+}
+
+std::string MusicPlayer::getOutputDescription() const {
+    return m_outputDescription;
+}
+
+std::string MusicPlayer::getMatrixDescription() const {
+    return m_matrixDescription;
+}
+
 std::string MusicPlayer::getMetadata(const std::string& key) const {
     if (!m_formatContext) {
         return "";
@@ -614,6 +848,11 @@ void MusicPlayer::cleanup() {
     if (m_swrContext) {
         swr_free(&m_swrContext);
     }
+    m_convertKernel = nullptr;
+    m_useMatrix = false;
+    m_matrixDirect = false;
+    m_outputDescription.clear();
+    m_matrixDescription.clear();
     
     if (m_codecContext) {
         avcodec_free_context(&m_codecContext);
@@ -4,6 +4,7 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <vector>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -15,6 +16,15 @@ extern "C" {
 
 #include <SDL.h>
 
+#include "AudioInput.h"
+#include "SampleConvert.h"
+#include "ChannelMatrix.h"
+#include "DspChain.h"
+#include "TimeStretch.h"
+
+class SpectrumAnalyzer;
+class StreamServer;
+
 class MusicPlayer {
 public:
     enum class State {
@@ -22,6 +32,12 @@ public:
         PLAYING,
         PAUSED
     };
+    
+    // 输出声道设置，下次 loadFile 时生效
+    struct OutputOptions {
+        int maxChannels = 0;          // 0 = as many as the source and the device allow
+        ChannelMatrix::Gains gains;   // used whenever source and output layouts differ
+    };
 
     MusicPlayer();
     ~MusicPlayer();
@@ -35,12 +51,32 @@ public:
     void setVolume(float volume); // 0.0 to 1.0
     float getVolume() const;
     
+    // 变速不变调，0.5 到 2.0，可在播放中随时调整
+    void setSpeed(float speed);
+    float getSpeed() const;
+    
     double getCurrentTime() const;
     double getDuration() const;
     State getState() const;
     
     std::string getCurrentFile() const;
     std::string getMetadata(const std::string& key) const;
+    
+    void setOutputOptions(const OutputOptions& options);
+    const OutputOptions& getOutputOptions() const;
+    
+    // 例如 "5.1(side) -> stereo (channel matrix)"；矩阵描述每个输出声道一行
+    std::string getOutputDescription() const;
+    std::string getMatrixDescription() const;
+    
+    // 解码后、送入 SDL 之前的处理链（每个播放器实例独立）
+    DspChain& getDspChain();
+    
+    // 输出 PCM 的分析旁路；调用方持有对象，销毁前需先停止播放并传入 nullptr
+    void setAnalyzer(SpectrumAnalyzer* analyzer);
+    
+    // 网络串流输出，约定同上
+    void setStreamServer(StreamServer* server);
 
 private:
     // FFmpeg 核心组件
@@ -49,6 +85,21 @@ private:
     SwrContext* m_swrContext;
     AVStream* m_audioStream;
     
+    // 无需重采样时使用的专用转换内核（nullptr 表示走 swr_convert）
+    SampleConvert::Kernel m_convertKernel;
+    
+    // 声道布局不同时代替 swr 重混；swr 只负责格式与采样率转换
+    ChannelMatrix m_channelMatrix;
+    ChannelMatrix m_streamDownmix;   // device layout -> stereo for the LAN stream
+    bool m_useMatrix;
+    bool m_matrixDirect;                  // 解码器已输出设备采样率的平面浮点
+    std::vector<float> m_matrixBuffer;    // 否则为 swr 输出的平面缓冲区
+    std::vector<uint8_t*> m_matrixPlanes;
+    int m_matrixCapacity;
+    OutputOptions m_outputOptions;
+    std::string m_outputDescription;
+    std::string m_matrixDescription;
+    
     // SDL 音频组件
     SDL_AudioDeviceID m_audioDevice;
     SDL_AudioSpec m_audioSpec;
@@ -64,6 +115,17 @@ private:
     std::thread m_decodingThread;
     std::atomic<bool> m_shouldStop;
     
+    // DSP 处理链及其预分配的浮点缓冲区
+    DspChain m_dspChain;
+    std::vector<float> m_dspBuffer;
+    
+    // 变速处理（位于解码转换之后、DSP 之前）
+    TimeStretch m_timeStretch;
+    
+    // 频谱分析旁路（可为空）
+    std::atomic<SpectrumAnalyzer*> m_analyzer;
+    std::atomic<StreamServer*> m_streamServer;
+    
     // 当前文件元数据
     std::string m_currentFile;
     double m_duration;
@@ -77,6 +139,9 @@ private:
     
     bool setupAudioConversion();
     int decodeAudioFrame(AVFrame* frame, uint8_t** output, int* outputSize);
+    void allocateMatrixPlanes(int frames);
+    void processDsp(int16_t* samples, int sampleCount);
+    void queueSamples(int16_t* samples, int frames);
 };
 
 #endif // MUSICPLAYER_H
\ No newline at end of file
@@ -0,0 +1,370 @@
+#include "ParametricEq.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#define PARAMETRICEQ_SSE 1
+#endif
+
+namespace {
+
+// Runs one biquad over a block of LANES-wide frames in place. z holds
+// z1[4] followed by z2[4]. When ramping, coefficients move linearly from
+// `from` to `to` across the block.
+void runBiquad(float* data, int frames, float* z,
+               const float from[5], const float to[5], bool ramp) {
+#ifdef PARAMETRICEQ_SSE
+    __m128 b0 = _mm_set1_ps(from[0]);
+    __m128 b1 = _mm_set1_ps(from[1]);
+    __m128 b2 = _mm_set1_ps(from[2]);
+    __m128 a1 = _mm_set1_ps(from[3]);
+    __m128 a2 = _mm_set1_ps(from[4]);
+    __m128 z1 = _mm_loadu_ps(z);
+    __m128 z2 = _mm_loadu_ps(z + 4);
+
+    if (ramp) {
+        const float inv = 1.0f / frames;
+        const __m128 db0 = _mm_set1_ps((to[0] - from[0]) * inv);
+        const __m128 db1 = _mm_set1_ps((to[1] - from[1]) * inv);
+        const __m128 db2 = _mm_set1_ps((to[2] - from[2]) * inv);
+        const __m128 da1 = _mm_set1_ps((to[3] - from[3]) * inv);
+        const __m128 da2 = _mm_set1_ps((to[4] - from[4]) * inv);
+        for (int i = 0; i < frames; i++) {
+            b0 = _mm_add_ps(b0, db0);
+            b1 = _mm_add_ps(b1, db1);
+            b2 = _mm_add_ps(b2, db2);
+            a1 = _mm_add_ps(a1, da1);
+            a2 = _mm_add_ps(a2, da2);
+            __m128 x = _mm_loadu_ps(data + i * 4);
+            __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+            z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+            z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+            _mm_storeu_ps(data + i * 4, y);
+        }
+    } else {
+        for (int i = 0; i < frames; i++) {
+            __m128 x = _mm_loadu_ps(data + i * 4);
+            __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+            z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+            z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+            _mm_storeu_ps(data + i * 4, y);
+        }
+    }
+
+    _mm_storeu_ps(z, z1);
+    _mm_storeu_ps(z + 4, z2);
+#else
+    float c[5], d[5] = {0, 0, 0, 0, 0};
+    for (int k = 0; k < 5; k++) {
+        c[k] = from[k];
+        if (ramp) d[k] = (to[k] - from[k]) / frames;
+    }
+    float z1[4], z2[4];
+    std::memcpy(z1, z, sizeof(z1));
+    std::memcpy(z2, z + 4, sizeof(z2));
+
+    for (int i = 0; i < frames; i++) {
+        for (int k = 0; k < 5; k++) c[k] += d[k];
+        float* x = data + i * 4;
+        for (int l = 0; l < 4; l++) {
+            float y = c[0] * x[l] + z1[l];
+            z1[l] = c[1] * x[l] - c[3] * y + z2[l];
+            z2[l] = c[2] * x[l] - c[4] * y;
+            x[l] = y;
+        }
+    }
+
+    std::memcpy(z, z1, sizeof(z1));
+    std::memcpy(z + 4, z2, sizeof(z2));
+#endif
+}
+
+#ifdef PARAMETRICEQ_SSE
+// Filter state decays into denormals on silence, which is very slow on x86
+class DenormalGuard {
+public:
+    DenormalGuard() : m_csr(_mm_getcsr()) { _mm_setcsr(m_csr | 0x8040); }
+    ~DenormalGuard() { _mm_setcsr(m_csr); }
+private:
+    unsigned int m_csr;
+};
+#endif
+
+} // namespace
+
+ParametricEq::ParametricEq()
+    : m_sampleRate(0)
+    , m_preGainDb(0.0f)
+    , m_rampPending(false)
+    , m_channels(0)
+    , m_groups(0)
+{
+    m_current.bandCount = 0;
+    for (int i = 0; i < MAX_BANDS; i++) {
+        setIdentity(m_current, i);
+    }
+    m_previous = m_current;
+}
+
+bool ParametricEq::setBand(int index, const Band& band) {
+    if (index < 0 || index >= MAX_BANDS) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_bandsMutex);
+    m_bands[index] = band;
+    publishCoefficients();
+    return true;
+}
+
+ParametricEq::Band ParametricEq::getBand(int index) const {
+    std::lock_guard<std::mutex> lock(m_bandsMutex);
+    if (index < 0 || index >= MAX_BANDS) {
+        return Band();
+    }
+    return m_bands[index];
+}
+
+void ParametricEq::clearBands() {
+    std::lock_guard<std::mutex> lock(m_bandsMutex);
+    for (auto& band : m_bands) {
+        band.enabled = false;
+    }
+    publishCoefficients();
+}
+
+int ParametricEq::getActiveBandCount() const {
+    std::lock_guard<std::mutex> lock(m_bandsMutex);
+    return static_cast<int>(std::count_if(std::begin(m_bands), std::end(m_bands),
+                                          [](const Band& band) { return band.enabled; }));
+}
+
+float ParametricEq::getPreGainDb() const {
+    std::lock_guard<std::mutex> lock(m_bandsMutex);
+    return m_preGainDb;
+}
+
+// Caller holds m_bandsMutex
+void ParametricEq::publishCoefficients() {
+    if (m_sampleRate <= 0) {
+        return;
+    }
+
+    Coefficients& out = m_coefficients.writeBuffer();
+    out.bandCount = 0;
+    for (int i = 0; i < MAX_BANDS; i++) {
+        if (m_bands[i].enabled) {
+            designBand(m_bands[i], m_sampleRate, out, i);
+            out.bandCount = i + 1;
+        } else {
+            setIdentity(out, i);
+        }
+    }
+
+    // Find the cascade's loudest point: a log-spaced sweep, plus every
+    // band's own frequency so narrow peaks cannot fall between grid points
+    constexpr int kGridPoints = 256;
+    const double nyquist = m_sampleRate * 0.5;
+    const double lowest = std::log(10.0);
+    const double highest = std::log(nyquist * 0.98);
+    double peak = 1.0;
+    for (int i = 0; i < kGridPoints; i++) {
+        double frequency = std::exp(lowest + (highest - lowest) * i / (kGridPoints - 1));
+        peak = std::max(peak, cascadeGain(out, M_PI * frequency / nyquist));
+    }
+    for (int i = 0; i < out.bandCount; i++) {
+        if (m_bands[i].enabled) {
+            double frequency = std::clamp(static_cast<double>(m_bands[i].frequency), 10.0, nyquist * 0.98);
+            peak = std::max(peak, cascadeGain(out, M_PI * frequency / nyquist));
+        }
+    }
+
+    // Folded into the first stage, so headroom costs nothing per sample
+    // and ramps along with the coefficients
+    m_preGainDb = 0.0f;
+    if (peak > 1.0) {
+        m_preGainDb = static_cast<float>(-20.0 * std::log10(peak));
+        const float gain = static_cast<float>(1.0 / peak);
+        out.b0[0] *= gain;
+        out.b1[0] *= gain;
+        out.b2[0] *= gain;
+    }
+    m_coefficients.publish();
+}
+
+// |H(e^jw)| of all active stages
+double ParametricEq::cascadeGain(const Coefficients& c, double w) {
+    const double cos1 = std::cos(w), sin1 = std::sin(w);
+    const double cos2 = std::cos(2 * w), sin2 = std::sin(2 * w);
+    double gain = 1.0;
+    for (int i = 0; i < c.bandCount; i++) {
+        double nr = c.b0[i] + c.b1[i] * cos1 + c.b2[i] * cos2;
+        double ni = c.b1[i] * sin1 + c.b2[i] * sin2;
+        double dr = 1.0 + c.a1[i] * cos1 + c.a2[i] * cos2;
+        double di = c.a1[i] * sin1 + c.a2[i] * sin2;
+        gain *= std::sqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+    }
+    return gain;
+}
+
+void ParametricEq::setIdentity(Coefficients& out, int index) {
+    out.b0[index] = 1.0f;
+    out.b1[index] = 0.0f;
+    out.b2[index] = 0.0f;
+    out.a1[index] = 0.0f;
+    out.a2[index] = 0.0f;
+}
+
+// RBJ Audio EQ Cookbook formulas
+void ParametricEq::designBand(const Band& band, int sampleRate, Coefficients& out, int index) {
+    double frequency = std::clamp(static_cast<double>(band.frequency), 10.0, sampleRate * 0.49);
+    double q = std::max(static_cast<double>(band.q), 0.05);
+    double A = std::pow(10.0, band.gainDb / 40.0);
+    double w0 = 2.0 * M_PI * frequency / sampleRate;
+    double cosw = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * q);
+    double sqrtA2alpha = 2.0 * std::sqrt(A) * alpha;
+
+    double b0, b1, b2, a0, a1, a2;
+    switch (band.type) {
+        case FilterType::LowShelf:
+            b0 = A * ((A + 1) - (A - 1) * cosw + sqrtA2alpha);
+            b1 = 2 * A * ((A - 1) - (A + 1) * cosw);
+            b2 = A * ((A + 1) - (A - 1) * cosw - sqrtA2alpha);
+            a0 = (A + 1) + (A - 1) * cosw + sqrtA2alpha;
+            a1 = -2 * ((A - 1) + (A + 1) * cosw);
+            a2 = (A + 1) + (A - 1) * cosw - sqrtA2alpha;
+            break;
+        case FilterType::HighShelf:
+            b0 = A * ((A + 1) + (A - 1) * cosw + sqrtA2alpha);
+            b1 = -2 * A * ((A - 1) + (A + 1) * cosw);
+            b2 = A * ((A + 1) + (A - 1) * cosw - sqrtA2alpha);
+            a0 = (A + 1) - (A - 1) * cosw + sqrtA2alpha;
+            a1 = 2 * ((A - 1) - (A + 1) * cosw);
+            a2 = (A + 1) - (A - 1) * cosw - sqrtA2alpha;
+            break;
+        case FilterType::LowPass:
+            b0 = (1 - cosw) / 2;
+            b1 = 1 - cosw;
+            b2 = (1 - cosw) / 2;
+            a0 = 1 + alpha;
+            a1 = -2 * cosw;
+            a2 = 1 - alpha;
+            break;
+        case FilterType::HighPass:
+            b0 = (1 + cosw) / 2;
+            b1 = -(1 + cosw);
+            b2 = (1 + cosw) / 2;
+            a0 = 1 + alpha;
+            a1 = -2 * cosw;
+            a2 = 1 - alpha;
+            break;
+        case FilterType::Peaking:
+        default:
+            b0 = 1 + alpha * A;
+            b1 = -2 * cosw;
+            b2 = 1 - alpha * A;
+            a0 = 1 + alpha / A;
+            a1 = -2 * cosw;
+            a2 = 1 - alpha / A;
+            break;
+    }
+
+    out.b0[index] = static_cast<float>(b0 / a0);
+    out.b1[index] = static_cast<float>(b1 / a0);
+    out.b2[index] = static_cast<float>(b2 / a0);
+    out.a1[index] = static_cast<float>(a1 / a0);
+    out.a2[index] = static_cast<float>(a2 / a0);
+}
+
+void ParametricEq::prepare(int sampleRate, int channels) {
+    {
+        std::lock_guard<std::mutex> lock(m_bandsMutex);
+        m_sampleRate = sampleRate;
+        publishCoefficients();
+    }
+
+    // Playback is stopped, so it is safe to act as the reader here
+    if (m_coefficients.update()) {
+        m_current = m_coefficients.readBuffer();
+    }
+    m_previous = m_current;
+    m_rampPending = false;
+
+    m_channels = channels;
+    m_groups = (channels + LANES - 1) / LANES;
+    m_state.assign(static_cast<size_t>(m_groups) * MAX_BANDS * LANES * 2, 0.0f);
+    m_scratch.assign(static_cast<size_t>(MAX_BLOCK) * LANES, 0.0f);
+}
+
+void ParametricEq::reset() {
+    std::fill(m_state.begin(), m_state.end(), 0.0f);
+}
+
+void ParametricEq::process(float* samples, int frames) {
+    if (m_coefficients.update()) {
+        m_previous = m_current;
+        m_current = m_coefficients.readBuffer();
+        m_rampPending = true;
+    }
+
+    int bands = m_current.bandCount;
+    if (m_rampPending) {
+        bands = std::max(bands, m_previous.bandCount);
+    }
+    if (bands == 0 || m_groups == 0 || frames <= 0) {
+        m_rampPending = false;
+        return;
+    }
+
+#ifdef PARAMETRICEQ_SSE
+    DenormalGuard denormalGuard;
+#endif
+
+    float* scratch = m_scratch.data();
+    for (int offset = 0; offset < frames; offset += MAX_BLOCK) {
+        int count = std::min(MAX_BLOCK, frames - offset);
+        float* block = samples + static_cast<size_t>(offset) * m_channels;
+
+        for (int group = 0; group < m_groups; group++) {
+            int firstChannel = group * LANES;
+            int lanes = std::min(LANES, m_channels - firstChannel);
+
+            // Gather this group's channels into LANES-wide frames
+            for (int i = 0; i < count; i++) {
+                const float* in = block + i * m_channels + firstChannel;
+                float* out = scratch + i * LANES;
+                for (int l = 0; l < LANES; l++) {
+                    out[l] = l < lanes ? in[l] : 0.0f;
+                }
+            }
+
+            float* state = m_state.data() + static_cast<size_t>(group) * MAX_BANDS * LANES * 2;
+            for (int b = 0; b < bands; b++) {
+                const float to[5] = { m_current.b0[b], m_current.b1[b], m_current.b2[b],
+                                      m_current.a1[b], m_current.a2[b] };
+                if (m_rampPending) {
+                    const float from[5] = { m_previous.b0[b], m_previous.b1[b], m_previous.b2[b],
+                                            m_previous.a1[b], m_previous.a2[b] };
+                    runBiquad(scratch, count, state + b * LANES * 2, from, to, true);
+                } else {
+                    runBiquad(scratch, count, state + b * LANES * 2, to, to, false);
+                }
+            }
+
+            for (int i = 0; i < count; i++) {
+                const float* in = scratch + i * LANES;
+                float* out = block + i * m_channels + firstChannel;
+                for (int l = 0; l < lanes; l++) {
+                    out[l] = in[l];
+                }
+            }
+        }
+
+        // The ramp spans the first block only
+        m_rampPending = false;
+    }
+}
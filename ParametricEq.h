@@ -0,0 +1,85 @@
+#ifndef PARAMETRICEQ_H
+#define PARAMETRICEQ_H
+
+#include "DspChain.h"
+#include "TripleBuffer.h"
+#include <mutex>
+#include <vector>
+
+// Biquad-cascade parametric equalizer. Channels are processed four at a
+// time in SIMD lanes with all state preallocated in prepare(). Band changes
+// from the control thread are handed to the decoding thread through a
+// triple buffer and ramped over one block, so they never click. The input
+// is already full-scale S16, so the cascade is scaled down by its peak
+// boost and never clips on the way back to S16.
+class ParametricEq : public AudioProcessor {
+public:
+    static constexpr int MAX_BANDS = 16;
+
+    enum class FilterType {
+        Peaking,
+        LowShelf,
+        HighShelf,
+        LowPass,
+        HighPass
+    };
+
+    struct Band {
+        bool enabled = false;
+        FilterType type = FilterType::Peaking;
+        float frequency = 1000.0f;  // Hz
+        float gainDb = 0.0f;        // ignored by low/high pass
+        float q = 0.707f;
+    };
+
+    ParametricEq();
+
+    // Control thread
+    bool setBand(int index, const Band& band);
+    Band getBand(int index) const;
+    void clearBands();
+    int getActiveBandCount() const;
+    float getPreGainDb() const;     // <= 0, headroom for the loudest boost
+
+    void prepare(int sampleRate, int channels) override;
+    void process(float* samples, int frames) override;
+    void reset() override;
+
+private:
+    static constexpr int MAX_BLOCK = 1024;
+    static constexpr int LANES = 4;
+
+    // Normalized biquad coefficients, a0 == 1. Unused bands are identity.
+    struct Coefficients {
+        int bandCount;
+        float b0[MAX_BANDS];
+        float b1[MAX_BANDS];
+        float b2[MAX_BANDS];
+        float a1[MAX_BANDS];
+        float a2[MAX_BANDS];
+    };
+
+    void publishCoefficients();
+    static void designBand(const Band& band, int sampleRate, Coefficients& out, int index);
+    static void setIdentity(Coefficients& out, int index);
+    static double cascadeGain(const Coefficients& c, double w);
+
+    // 控制线程参数（受互斥锁保护，音频线程不访问）
+    mutable std::mutex m_bandsMutex;
+    Band m_bands[MAX_BANDS];
+    int m_sampleRate;
+    float m_preGainDb;
+
+    TripleBuffer<Coefficients> m_coefficients;
+
+    // 音频线程状态
+    Coefficients m_current;
+    Coefficients m_previous;
+    bool m_rampPending;
+    int m_channels;
+    int m_groups;                 // ceil(channels / LANES)
+    std::vector<float> m_state;   // [group][band][z1 lanes, z2 lanes]
+    std::vector<float> m_scratch; // MAX_BLOCK frames x LANES
+};
+
+#endif // PARAMETRICEQ_H
@@ -0,0 +1,285 @@
+#include "SampleConvert.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SAMPLECONVERT_SSE2 1
+#endif
+
+namespace SampleConvert {
+
+namespace {
+
+// Same rounding and clipping as swr: av_clip_int16(lrintf(x * (1 << 15)))
+inline int16_t floatToS16(float x) {
+    float scaled = x * 32768.0f;
+    if (scaled >= 32767.0f) return 32767;
+    if (scaled <= -32768.0f) return -32768;
+#ifdef SAMPLECONVERT_SSE2
+    // cvtss2si rounds like lrintf, which is otherwise a libm call per sample
+    return static_cast<int16_t>(_mm_cvtss_si32(_mm_set_ss(scaled)));
+#else
+    return static_cast<int16_t>(lrintf(scaled));
+#endif
+}
+
+#ifdef SAMPLECONVERT_SSE2
+// cvtps2dq rounds with the current mode (nearest-even, like lrintf).
+// Positive overs must be clamped before they wrap to INT_MIN; negative
+// ones already become INT_MIN, which packs_epi32 saturates correctly.
+inline __m128i floatToS32x4(__m128 x) {
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_mul_ps(x, scale), hi));
+}
+#endif
+
+// Interleaved float -> interleaved S16. Channel count only scales the
+// sample count, so all channel instantiations share this loop.
+void floatToS16Block(const float* in, int16_t* out, int count) {
+    int i = 0;
+#ifdef SAMPLECONVERT_SSE2
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = floatToS32x4(_mm_loadu_ps(in + i));
+        __m128i b = floatToS32x4(_mm_loadu_ps(in + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(a, b));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = floatToS16(in[i]);
+    }
+}
+
+template <int Channels>
+void convertFlt(const uint8_t* const* in, int16_t* out, int frames) {
+    floatToS16Block(reinterpret_cast<const float*>(in[0]), out, frames * Channels);
+}
+
+template <int Channels>
+void convertS16(const uint8_t* const* in, int16_t* out, int frames) {
+    std::memcpy(out, in[0], static_cast<size_t>(frames) * Channels * sizeof(int16_t));
+}
+
+// Generic channel counts are defined after convertS16p, which they reuse
+template <int Channels>
+void convertFltp(const uint8_t* const* in, int16_t* out, int frames);
+
+template <>
+void convertFltp<1>(const uint8_t* const* in, int16_t* out, int frames) {
+    floatToS16Block(reinterpret_cast<const float*>(in[0]), out, frames);
+}
+
+template <>
+void convertFltp<2>(const uint8_t* const* in, int16_t* out, int frames) {
+    const float* left = reinterpret_cast<const float*>(in[0]);
+    const float* right = reinterpret_cast<const float*>(in[1]);
+    int i = 0;
+#ifdef SAMPLECONVERT_SSE2
+    for (; i + 8 <= frames; i += 8) {
+        __m128i l = _mm_packs_epi32(floatToS32x4(_mm_loadu_ps(left + i)),
+                                    floatToS32x4(_mm_loadu_ps(left + i + 4)));
+        __m128i r = _mm_packs_epi32(floatToS32x4(_mm_loadu_ps(right + i)),
+                                    floatToS32x4(_mm_loadu_ps(right + i + 4)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2 + 8), _mm_unpackhi_epi16(l, r));
+    }
+#endif
+    for (; i < frames; i++) {
+        out[i * 2] = floatToS16(left[i]);
+        out[i * 2 + 1] = floatToS16(right[i]);
+    }
+}
+
+// Planar S16 -> interleaved S16
+template <int Channels>
+void convertS16p(const uint8_t* const* in, int16_t* out, int frames) {
+    const int16_t* planes[Channels];
+    for (int c = 0; c < Channels; c++) {
+        planes[c] = reinterpret_cast<const int16_t*>(in[c]);
+    }
+
+    int i = 0;
+#ifdef SAMPLECONVERT_SSE2
+    // Even channel counts: interleave plane pairs eight frames at a time,
+    // then each frame is Channels / 2 32-bit words
+    if constexpr (Channels % 2 == 0) {
+        constexpr int kPairs = Channels / 2;
+        alignas(16) uint32_t pairs[kPairs][8];
+        for (; i + 8 <= frames; i += 8) {
+            for (int p = 0; p < kPairs; p++) {
+                __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2 * p] + i));
+                __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2 * p + 1] + i));
+                _mm_store_si128(reinterpret_cast<__m128i*>(pairs[p]), _mm_unpacklo_epi16(l, r));
+                _mm_store_si128(reinterpret_cast<__m128i*>(pairs[p] + 4), _mm_unpackhi_epi16(l, r));
+            }
+            int16_t* dst = out + static_cast<size_t>(i) * Channels;
+            for (int f = 0; f < 8; f++) {
+                for (int p = 0; p < kPairs; p++) {
+                    std::memcpy(dst + f * Channels + p * 2, &pairs[p][f], sizeof(uint32_t));
+                }
+            }
+        }
+    }
+#endif
+    for (; i < frames; i++) {
+        for (int c = 0; c < Channels; c++) {
+            out[i * Channels + c] = planes[c][i];
+        }
+    }
+}
+
+template <>
+void convertS16p<1>(const uint8_t* const* in, int16_t* out, int frames) {
+    std::memcpy(out, in[0], static_cast<size_t>(frames) * sizeof(int16_t));
+}
+
+template <>
+void convertS16p<2>(const uint8_t* const* in, int16_t* out, int frames) {
+    const int16_t* left = reinterpret_cast<const int16_t*>(in[0]);
+    const int16_t* right = reinterpret_cast<const int16_t*>(in[1]);
+    int i = 0;
+#ifdef SAMPLECONVERT_SSE2
+    for (; i + 8 <= frames; i += 8) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2 + 8), _mm_unpackhi_epi16(l, r));
+    }
+#endif
+    for (; i < frames; i++) {
+        out[i * 2] = left[i];
+        out[i * 2 + 1] = right[i];
+    }
+}
+
+// Planar float -> interleaved S16. Each plane is converted with the
+// vector loop into a small S16 block first, then the blocks go through
+// the S16 interleave.
+template <int Channels>
+void convertFltp(const uint8_t* const* in, int16_t* out, int frames) {
+    constexpr int kChunk = 256;
+    alignas(16) int16_t block[Channels][kChunk];
+    const uint8_t* blockPlanes[Channels];
+    for (int c = 0; c < Channels; c++) {
+        blockPlanes[c] = reinterpret_cast<const uint8_t*>(block[c]);
+    }
+
+    for (int done = 0; done < frames; done += kChunk) {
+        const int count = frames - done < kChunk ? frames - done : kChunk;
+        for (int c = 0; c < Channels; c++) {
+            floatToS16Block(reinterpret_cast<const float*>(in[c]) + done, block[c], count);
+        }
+        convertS16p<Channels>(blockPlanes, out + static_cast<size_t>(done) * Channels, count);
+    }
+}
+
+// Mono -> stereo. swr maps FC to FL/FR with M_SQRT1_2; the integer path
+// uses a Q15 coefficient, so match that for S16 input.
+void monoFltToStereo(const uint8_t* const* in, int16_t* out, int frames) {
+    const float* mono = reinterpret_cast<const float*>(in[0]);
+    const float gain = static_cast<float>(M_SQRT1_2);
+    int i = 0;
+#ifdef SAMPLECONVERT_SSE2
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= frames; i += 4) {
+        __m128i s = floatToS32x4(_mm_mul_ps(_mm_loadu_ps(mono + i), g));
+        s = _mm_packs_epi32(s, s);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_unpacklo_epi16(s, s));
+    }
+#endif
+    for (; i < frames; i++) {
+        int16_t s = floatToS16(mono[i] * gain);
+        out[i * 2] = s;
+        out[i * 2 + 1] = s;
+    }
+}
+
+void monoS16ToStereo(const uint8_t* const* in, int16_t* out, int frames) {
+    const int16_t* mono = reinterpret_cast<const int16_t*>(in[0]);
+    const int coeff = static_cast<int>(lrint(M_SQRT1_2 * 32768.0));
+    int i = 0;
+#ifdef SAMPLECONVERT_SSE2
+    // Full 32-bit products from the low and high halves, then the same
+    // rounding shift as the scalar loop
+    const __m128i c = _mm_set1_epi16(static_cast<int16_t>(coeff));
+    const __m128i round = _mm_set1_epi32(16384);
+    for (; i + 8 <= frames; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mono + i));
+        __m128i lo16 = _mm_mullo_epi16(x, c);
+        __m128i hi16 = _mm_mulhi_epi16(x, c);
+        __m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo16, hi16), round), 15);
+        __m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo16, hi16), round), 15);
+        __m128i s = _mm_packs_epi32(lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_unpacklo_epi16(s, s));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2 + 8), _mm_unpackhi_epi16(s, s));
+    }
+#endif
+    for (; i < frames; i++) {
+        int16_t s = static_cast<int16_t>((mono[i] * coeff + 16384) >> 15);
+        out[i * 2] = s;
+        out[i * 2 + 1] = s;
+    }
+}
+
+struct KernelEntry {
+    AVSampleFormat format;
+    int inChannels;
+    int outChannels;
+    Kernel kernel;
+};
+
+#define SAMPLECONVERT_PER_CHANNEL(fmt, fn) \
+    { fmt, 1, 1, fn<1> }, { fmt, 2, 2, fn<2> }, { fmt, 3, 3, fn<3> }, { fmt, 4, 4, fn<4> }, \
+    { fmt, 5, 5, fn<5> }, { fmt, 6, 6, fn<6> }, { fmt, 7, 7, fn<7> }, { fmt, 8, 8, fn<8> }
+
+const KernelEntry kKernels[] = {
+    SAMPLECONVERT_PER_CHANNEL(AV_SAMPLE_FMT_FLTP, convertFltp),
+    SAMPLECONVERT_PER_CHANNEL(AV_SAMPLE_FMT_FLT, convertFlt),
+    SAMPLECONVERT_PER_CHANNEL(AV_SAMPLE_FMT_S16P, convertS16p),
+    SAMPLECONVERT_PER_CHANNEL(AV_SAMPLE_FMT_S16, convertS16),
+    // A single channel has the same layout planar or packed
+    { AV_SAMPLE_FMT_FLTP, 1, 2, monoFltToStereo },
+    { AV_SAMPLE_FMT_FLT, 1, 2, monoFltToStereo },
+    { AV_SAMPLE_FMT_S16P, 1, 2, monoS16ToStereo },
+    { AV_SAMPLE_FMT_S16, 1, 2, monoS16ToStereo },
+};
+
+#undef SAMPLECONVERT_PER_CHANNEL
+
+} // namespace
+
+void toFloat(const int16_t* in, float* out, int count) {
+    const float scale = 1.0f / 32768.0f;
+    int i = 0;
+#ifdef SAMPLECONVERT_SSE2
+    const __m128 s = _mm_set1_ps(scale);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign-extend by unpacking into the high half and shifting back down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = in[i] * scale;
+    }
+}
+
+void toS16(const float* in, int16_t* out, int count) {
+    floatToS16Block(in, out, count);
+}
+
+Kernel findKernel(AVSampleFormat inFormat, int inChannels, int outChannels) {
+    for (const auto& entry : kKernels) {
+        if (entry.format == inFormat && entry.inChannels == inChannels &&
+            entry.outChannels == outChannels) {
+            return entry.kernel;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace SampleConvert
@@ -0,0 +1,32 @@
+#ifndef SAMPLECONVERT_H
+#define SAMPLECONVERT_H
+
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/samplefmt.h>
+}
+
+// Specialized sample conversion kernels for the format pairs that make up
+// most of the catalog. They replace swr_convert when no resampling or
+// remixing is needed and always produce interleaved signed 16-bit output.
+namespace SampleConvert {
+
+// in:  frame->extended_data (one plane per channel for planar formats)
+// out: interleaved S16, frames * outChannels samples
+using Kernel = void (*)(const uint8_t* const* in, int16_t* out, int frames);
+
+// Returns nullptr if no specialized kernel handles this combination.
+// inChannels == outChannels selects a pure format conversion/interleave;
+// inChannels == 1 with outChannels == 2 selects the mono upmix, which
+// applies the same -3 dB center gain swr uses for FC -> FL/FR.
+Kernel findKernel(AVSampleFormat inFormat, int inChannels, int outChannels);
+
+// Interleaved S16 <-> float in [-1, 1) for the float processing path.
+// toS16 saturates and rounds like swr.
+void toFloat(const int16_t* in, float* out, int count);
+void toS16(const float* in, int16_t* out, int count);
+
+} // namespace SampleConvert
+
+#endif // SAMPLECONVERT_H
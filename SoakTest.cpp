@@ -0,0 +1,575 @@
+#include "SoakTest.h"
+#include "Logger.h"
+#include "MusicPlayer.h"
+#include "Transcoder.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// Counting replacements for the global allocation functions. They are only
+// linked into music_player_soak, so the player itself is unaffected. C
+// allocations (FFmpeg, SDL) are covered by the heap figure instead.
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_frees{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    void* block = std::malloc(size ? size : 1);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return block;
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+    if (block) {
+        g_frees.fetch_add(1, std::memory_order_relaxed);
+        std::free(block);
+    }
+}
+
+void operator delete[](void* block) noexcept {
+    ::operator delete(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+    ::operator delete(block);
+}
+
+void operator delete[](void* block, std::size_t) noexcept {
+    ::operator delete(block);
+}
+
+namespace {
+
+constexpr int kMediaSeconds = 20;
+constexpr double kSeekToleranceSeconds = 1.0;
+constexpr int kSeekTimeoutMs = 1000;
+constexpr double kLatencyFloorMs = 5.0;   // smaller p99 growth is noise
+
+// Swallows the player's console chatter during cycles
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+// Restores std::cout even if the run throws
+struct ConsoleRedirect {
+    std::streambuf* original;
+    explicit ConsoleRedirect(std::streambuf* replacement) : original(std::cout.rdbuf(replacement)) {}
+    ~ConsoleRedirect() { std::cout.rdbuf(original); }
+};
+
+void putLe(std::ofstream& file, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        file.put(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+// Tones plus a little noise, one pitch per channel, so every channel and
+// every seek position carries distinct audio
+bool writeWav(const std::string& path, int sampleRate, int channels, int bits, bool isFloat,
+              unsigned seed) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    const uint32_t frames = static_cast<uint32_t>(sampleRate) * kMediaSeconds;
+    const int bytesPerSample = bits / 8;
+    const uint32_t dataSize = frames * channels * bytesPerSample;
+
+    file.write("RIFF", 4);
+    putLe(file, 36 + dataSize, 4);
+    file.write("WAVEfmt ", 8);
+    putLe(file, 16, 4);
+    putLe(file, isFloat ? 3 : 1, 2);
+    putLe(file, channels, 2);
+    putLe(file, sampleRate, 4);
+    putLe(file, sampleRate * channels * bytesPerSample, 4);
+    putLe(file, channels * bytesPerSample, 2);
+    putLe(file, bits, 2);
+    file.write("data", 4);
+    putLe(file, dataSize, 4);
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> noise(-0.02f, 0.02f);
+    for (uint32_t i = 0; i < frames; i++) {
+        double t = static_cast<double>(i) / sampleRate;
+        for (int c = 0; c < channels; c++) {
+            double frequency = 220.0 * (1.0 + 0.25 * c) * (1.0 + 0.05 * std::sin(t * 0.5));
+            float value = static_cast<float>(0.3 * std::sin(2.0 * M_PI * frequency * t)) + noise(random);
+            if (isFloat) {
+                uint32_t raw;
+                static_assert(sizeof(raw) == sizeof(value), "32-bit float expected");
+                std::memcpy(&raw, &value, sizeof(raw));
+                putLe(file, raw, 4);
+            } else {
+                int32_t scaled = static_cast<int32_t>(std::lrint(value * ((1 << (bits - 1)) - 1)));
+                putLe(file, static_cast<uint32_t>(scaled), bytesPerSample);
+            }
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+double readRssMb() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0;
+    long resident = 0;
+    if (statm >> pages >> resident) {
+        return resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+    }
+#endif
+    return 0.0;
+}
+
+double readHeapMb() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return (info.uordblks + info.hblkhd) / (1024.0 * 1024.0);
+#else
+    return 0.0;
+#endif
+}
+
+int readThreadCount() {
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) {
+            return std::atoi(line.c_str() + 8);
+        }
+    }
+#endif
+    return 0;
+}
+
+int readOpenFiles() {
+#ifdef __linux__
+    std::error_code error;
+    int count = 0;
+    for (std::filesystem::directory_iterator it("/proc/self/fd", error), end; !error && it != end;
+         it.increment(error)) {
+        count++;
+    }
+    return count;
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+SoakTest::SoakTest(const Options& options)
+    : m_options(options)
+    , m_random(options.seed)
+    , m_lastAllocations(0)
+    , m_lastSampleCycle(0)
+    , m_failures(0)
+    , m_seekTimeouts(0)
+{
+    m_options.sampleEvery = std::max(1, m_options.sampleEvery);
+}
+
+SoakTest::~SoakTest() = default;
+
+const char* SoakTest::stageName(int stage) {
+    switch (stage) {
+        case STAGE_LOAD: return "load";
+        case STAGE_PLAY: return "play";
+        case STAGE_SEEK: return "seek";
+        case STAGE_STOP: return "stop";
+        case STAGE_INIT: return "init";
+        default: return "?";
+    }
+}
+
+bool SoakTest::run() {
+    std::ostream out(std::cout.rdbuf());
+    NullBuffer null;
+    ConsoleRedirect redirect(&null);
+
+    // Only warnings and errors reach the terminal; the decoding thread's
+    // per-track info lines would drown the report
+    Logger::instance().setLevel(LogLevel::Warning);
+
+    if (!m_options.audioDriver.empty()) {
+        SDL_setenv("SDL_AUDIODRIVER", m_options.audioDriver.c_str(), 1);
+    }
+
+    if (!generateMedia(out)) {
+        return false;
+    }
+
+    out << "Soak: " << m_options.cycles << " cycles over " << m_media.size() << " files, sample every "
+        << m_options.sampleEvery << ", player rebuilt every " << m_options.recreateEvery << std::endl;
+    out << std::setw(7) << "cycle" << std::setw(8) << "secs" << std::setw(9) << "rss MB"
+        << std::setw(9) << "heap MB" << std::setw(9) << "live" << std::setw(8) << "new/cyc"
+        << std::setw(5) << "thr" << std::setw(5) << "fds";
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        out << std::setw(12) << (std::string(stageName(s)) + " p50/99");
+    }
+    out << std::endl;
+
+    const size_t windowCapacity = static_cast<size_t>(m_options.sampleEvery) * 4 + 16;
+    for (auto& latencies : m_latencies) {
+        latencies.reserve(windowCapacity);
+    }
+    m_samples.reserve(static_cast<size_t>(m_options.cycles / m_options.sampleEvery) + 2);
+
+    const auto start = Clock::now();
+    m_lastAllocations = g_allocations.load(std::memory_order_relaxed);
+    m_lastSampleCycle = 0;
+
+    int cycle = 0;
+    while (cycle < m_options.cycles) {
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if (m_options.maxMinutes > 0.0 && elapsed >= m_options.maxMinutes * 60.0) {
+            out << "Time limit reached after " << cycle << " cycles" << std::endl;
+            break;
+        }
+
+        if (!m_player || (m_options.recreateEvery > 0 && cycle > 0 && cycle % m_options.recreateEvery == 0)) {
+            recreatePlayer();
+        }
+
+        runCycle();
+        cycle++;
+
+        if (cycle % m_options.sampleEvery == 0) {
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            m_samples.push_back(takeSample(cycle, elapsed));
+            printSample(out, m_samples.back());
+        }
+    }
+
+    if (cycle != m_lastSampleCycle && cycle > 0) {
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        m_samples.push_back(takeSample(cycle, elapsed));
+        printSample(out, m_samples.back());
+    }
+
+    m_player.reset();
+
+    bool passed = evaluate(out);
+    if (!m_options.reportFile.empty()) {
+        if (writeReport()) {
+            out << "Samples written to " << m_options.reportFile << std::endl;
+        } else {
+            out << "Failed to write " << m_options.reportFile << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+bool SoakTest::generateMedia(std::ostream& out) {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    fs::path dir = m_options.mediaDir.empty() ? fs::temp_directory_path(error) / "music_player_soak"
+                                              : fs::path(m_options.mediaDir);
+    fs::create_directories(dir, error);
+    if (error) {
+        out << "Cannot create media directory " << dir.string() << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    // One file per conversion path: S16 kernel, mono upmix, 5.1 float
+    // through the channel matrix, 24-bit at a low rate
+    struct Spec {
+        const char* name;
+        int sampleRate;
+        int channels;
+        int bits;
+        bool isFloat;
+    };
+    const Spec specs[] = {
+        {"tone_44k_stereo_s16.wav", 44100, 2, 16, false},
+        {"tone_48k_mono_s16.wav", 48000, 1, 16, false},
+        {"tone_48k_5.1_float.wav", 48000, 6, 32, true},
+        {"tone_22k_stereo_s24.wav", 22050, 2, 24, false},
+    };
+
+    out << "Generating media in " << dir.string() << std::endl;
+    unsigned seed = m_options.seed;
+    for (const Spec& spec : specs) {
+        std::string path = (dir / spec.name).string();
+        if (!writeWav(path, spec.sampleRate, spec.channels, spec.bits, spec.isFloat, seed++)) {
+            out << "Failed to write " << path << std::endl;
+            return false;
+        }
+        m_media.push_back(path);
+    }
+
+    // Compressed copies exercise real demuxers and decoders; an encoder
+    // missing from this FFmpeg build just means fewer files
+    for (const char* codec : {"flac", "opus"}) {
+        Transcoder::Options options;
+        options.codec = codec;
+        options.outputDir = dir.string();
+        options.jobs = 1;
+        Transcoder transcoder(options);
+        if (!transcoder.run({m_media.front()})) {
+            out << "Skipping " << codec << " media (encoder unavailable)" << std::endl;
+            continue;
+        }
+        fs::path encoded = dir / fs::path(m_media.front()).stem();
+        for (const auto& entry : fs::directory_iterator(dir, error)) {
+            if (entry.path().stem() == encoded.filename() && entry.path().extension() != ".wav" &&
+                std::find(m_media.begin(), m_media.end(), entry.path().string()) == m_media.end()) {
+                m_media.push_back(entry.path().string());
+            }
+        }
+    }
+    return true;
+}
+
+void SoakTest::recreatePlayer() {
+    auto start = Clock::now();
+    m_player.reset();
+    m_player = std::make_unique<MusicPlayer>();
+    record(STAGE_INIT, start);
+}
+
+void SoakTest::runCycle() {
+    const std::string& file = m_media[m_random() % m_media.size()];
+
+    auto start = Clock::now();
+    if (!m_player->loadFile(file)) {
+        std::cerr << "Soak: failed to load " << file << std::endl;
+        m_failures++;
+        return;
+    }
+    record(STAGE_LOAD, start);
+
+    // Mostly normal speed, sometimes the time-stretch path
+    static const float kSpeeds[] = {1.0f, 1.0f, 1.0f, 0.75f, 1.5f, 2.0f};
+    m_player->setSpeed(kSpeeds[m_random() % (sizeof(kSpeeds) / sizeof(kSpeeds[0]))]);
+
+    start = Clock::now();
+    if (!m_player->play()) {
+        std::cerr << "Soak: failed to play " << file << std::endl;
+        m_failures++;
+        return;
+    }
+    record(STAGE_PLAY, start);
+    sleepMs(20, 120);
+
+    // Seek storm: stay clear of the end so the track cannot finish early
+    const double seekRange = std::max(0.0, m_player->getDuration() - 3.0);
+    const int seeks = static_cast<int>(m_random() % 4);
+    for (int i = 0; i < seeks && seekRange > 4.0; i++) {
+        double current = m_player->getCurrentTime();
+        double target = std::uniform_real_distribution<double>(0.0, seekRange)(m_random);
+        if (std::fabs(target - current) < 2.0 * kSeekToleranceSeconds) {
+            target = current < seekRange / 2 ? seekRange : 0.0;
+        }
+
+        start = Clock::now();
+        m_player->seek(target);
+        while (std::fabs(m_player->getCurrentTime() - target) > kSeekToleranceSeconds) {
+            if (Clock::now() - start > std::chrono::milliseconds(kSeekTimeoutMs)) {
+                m_seekTimeouts++;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        record(STAGE_SEEK, start);
+        sleepMs(5, 40);
+    }
+
+    if (m_random() % 4 == 0) {
+        m_player->pause();
+        sleepMs(5, 20);
+        m_player->play();
+    }
+
+    start = Clock::now();
+    m_player->stop();
+    record(STAGE_STOP, start);
+}
+
+void SoakTest::record(Stage stage, Clock::time_point start) {
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    m_latencies[stage].push_back(ms);
+}
+
+void SoakTest::sleepMs(int low, int high) {
+    int ms = std::uniform_int_distribution<int>(low, high)(m_random);
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+SoakTest::Sample SoakTest::takeSample(int cycle, double seconds) {
+    Sample sample;
+    sample.cycle = cycle;
+    sample.seconds = seconds;
+    sample.rssMb = readRssMb();
+    sample.heapMb = readHeapMb();
+
+    uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+    uint64_t frees = g_frees.load(std::memory_order_relaxed);
+    sample.liveAllocations = static_cast<int64_t>(allocations - frees);
+    sample.allocationsPerCycle = static_cast<double>(allocations - m_lastAllocations) /
+                                 std::max(1, cycle - m_lastSampleCycle);
+    sample.threads = readThreadCount();
+    sample.files = readOpenFiles();
+
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        std::vector<double>& window = m_latencies[s];
+        Percentiles& p = sample.latency[s];
+        p.count = window.size();
+        if (!window.empty()) {
+            std::sort(window.begin(), window.end());
+            p.p50 = window[window.size() / 2];
+            p.p99 = window[std::min(window.size() - 1, window.size() * 99 / 100)];
+            p.max = window.back();
+        }
+        window.clear();   // keeps its capacity
+    }
+
+    m_lastAllocations = g_allocations.load(std::memory_order_relaxed);
+    m_lastSampleCycle = cycle;
+    return sample;
+}
+
+void SoakTest::printSample(std::ostream& out, const Sample& sample) const {
+    out << std::fixed << std::setprecision(1)
+        << std::setw(7) << sample.cycle << std::setw(8) << sample.seconds
+        << std::setw(9) << sample.rssMb << std::setw(9) << sample.heapMb
+        << std::setw(9) << sample.liveAllocations << std::setw(8) << std::setprecision(0)
+        << sample.allocationsPerCycle << std::setw(5) << sample.threads << std::setw(5) << sample.files;
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        std::ostringstream cell;
+        if (sample.latency[s].count > 0) {
+            cell << std::fixed << std::setprecision(1) << sample.latency[s].p50 << "/"
+                 << sample.latency[s].p99;
+        } else {
+            cell << "-";
+        }
+        out << std::setw(12) << cell.str();
+    }
+    out << std::defaultfloat << std::endl;
+}
+
+bool SoakTest::evaluate(std::ostream& out) const {
+    out << "\n=== Soak Summary ===" << std::endl;
+    out << "Failed cycles: " << m_failures << ", seek timeouts: " << m_seekTimeouts << std::endl;
+
+    bool passed = m_failures == 0 && m_seekTimeouts == 0;
+    if (m_samples.size() < 2) {
+        out << "Too few samples to measure growth; run more cycles than -s" << std::endl;
+        out << (passed ? "PASS" : "FAIL") << std::endl;
+        return passed;
+    }
+
+    const Sample& first = m_samples.front();
+    const Sample& last = m_samples.back();
+
+    auto check = [&](const char* name, double from, double to, double limit, const char* unit) {
+        bool ok = to - from <= limit;
+        out << (ok ? "  ok   " : "  FAIL ") << std::left << std::setw(18) << name << std::right
+            << std::fixed << std::setprecision(1) << from << " -> " << to << " " << unit
+            << " (limit +" << limit << ")" << std::defaultfloat << std::endl;
+        passed = passed && ok;
+    };
+
+    out << "Growth from cycle " << first.cycle << " to " << last.cycle << ":" << std::endl;
+    if (first.rssMb > 0.0) {
+        check("RSS", first.rssMb, last.rssMb, m_options.maxRssGrowthMb, "MB");
+    }
+    if (first.heapMb > 0.0) {
+        check("Heap", first.heapMb, last.heapMb, m_options.maxHeapGrowthMb, "MB");
+    }
+    check("Live allocations", static_cast<double>(first.liveAllocations),
+          static_cast<double>(last.liveAllocations), static_cast<double>(m_options.maxAllocationGrowth), "");
+    if (first.threads > 0) {
+        check("Threads", first.threads, last.threads, m_options.maxThreadGrowth, "");
+    }
+    if (first.files > 0) {
+        check("Open files", first.files, last.files, m_options.maxFileGrowth, "");
+    }
+
+    // Latency: median p99 of the first and last three windows
+    const size_t edge = std::min<size_t>(3, m_samples.size() / 2);
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        std::vector<double> head;
+        std::vector<double> tail;
+        for (size_t i = 0; i < edge; i++) {
+            const Percentiles& early = m_samples[i].latency[s];
+            const Percentiles& late = m_samples[m_samples.size() - 1 - i].latency[s];
+            if (early.count > 0) {
+                head.push_back(early.p99);
+            }
+            if (late.count > 0) {
+                tail.push_back(late.p99);
+            }
+        }
+        if (head.empty() || tail.empty()) {
+            continue;
+        }
+        std::sort(head.begin(), head.end());
+        std::sort(tail.begin(), tail.end());
+        double from = head[head.size() / 2];
+        double to = tail[tail.size() / 2];
+        bool ok = to <= from * m_options.maxLatencyGrowth || to - from < kLatencyFloorMs;
+        out << (ok ? "  ok   " : "  FAIL ") << std::left << std::setw(18)
+            << (std::string(stageName(s)) + " p99") << std::right << std::fixed << std::setprecision(1)
+            << from << " -> " << to << " ms (limit x" << m_options.maxLatencyGrowth << ")"
+            << std::defaultfloat << std::endl;
+        passed = passed && ok;
+    }
+
+    out << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed;
+}
+
+bool SoakTest::writeReport() const {
+    std::ofstream file(m_options.reportFile, std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    file << "cycle,seconds,rss_mb,heap_mb,live_allocations,allocations_per_cycle,threads,open_files";
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        file << "," << stageName(s) << "_p50_ms," << stageName(s) << "_p99_ms," << stageName(s) << "_max_ms";
+    }
+    file << "\n";
+
+    for (const Sample& sample : m_samples) {
+        file << sample.cycle << "," << sample.seconds << "," << sample.rssMb << "," << sample.heapMb << ","
+             << sample.liveAllocations << "," << sample.allocationsPerCycle << "," << sample.threads << ","
+             << sample.files;
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            file << "," << sample.latency[s].p50 << "," << sample.latency[s].p99 << "," << sample.latency[s].max;
+        }
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,108 @@
+#ifndef SOAKTEST_H
+#define SOAKTEST_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+class MusicPlayer;
+
+// Long-run stability harness behind the music_player_soak target. A real
+// MusicPlayer on SDL's dummy audio driver runs thousands of short
+// load/play/seek/stop cycles over generated media, and is torn down and
+// rebuilt periodically so SDL is shut down and re-initialized too. Every
+// few cycles the harness samples RSS, heap, live allocations, threads,
+// open files and per-stage latency percentiles. The run fails when any of
+// them grows past its limit between the first sample (taken after one
+// warm-up window) and the last.
+class SoakTest {
+public:
+    struct Options {
+        int cycles = 2000;
+        double maxMinutes = 0.0;        // 0 = no time limit
+        int sampleEvery = 50;           // cycles per sample window
+        int recreateEvery = 100;        // rebuild the player (SDL re-init), 0 = never
+        std::string mediaDir;           // empty = system temp directory
+        std::string reportFile;         // CSV of every sample, empty = none
+        std::string audioDriver = "dummy";
+        unsigned seed = 1;
+
+        // Allowed growth from the first sample to the last
+        double maxRssGrowthMb = 16.0;
+        double maxHeapGrowthMb = 8.0;
+        int64_t maxAllocationGrowth = 5000;   // live operator new blocks
+        int maxThreadGrowth = 0;
+        int maxFileGrowth = 0;
+        double maxLatencyGrowth = 2.0;        // p99 ratio, ignored below +5 ms
+    };
+
+    explicit SoakTest(const Options& options);
+    ~SoakTest();
+
+    // Blocks for the whole run. False if a limit was exceeded or a cycle
+    // could not load or play its file.
+    bool run();
+
+private:
+    enum Stage {
+        STAGE_LOAD,
+        STAGE_PLAY,
+        STAGE_SEEK,
+        STAGE_STOP,
+        STAGE_INIT,     // destroy + construct the player
+        STAGE_COUNT
+    };
+
+    struct Percentiles {
+        double p50 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        size_t count = 0;
+    };
+
+    struct Sample {
+        int cycle;
+        double seconds;
+        double rssMb;
+        double heapMb;
+        int64_t liveAllocations;
+        double allocationsPerCycle;
+        int threads;
+        int files;
+        Percentiles latency[STAGE_COUNT];
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    bool generateMedia(std::ostream& out);
+    void recreatePlayer();
+    void runCycle();
+    void record(Stage stage, Clock::time_point start);
+    void sleepMs(int low, int high);
+    Sample takeSample(int cycle, double seconds);
+    void printSample(std::ostream& out, const Sample& sample) const;
+    bool evaluate(std::ostream& out) const;
+    bool writeReport() const;
+
+    static const char* stageName(int stage);
+
+    Options m_options;
+    std::unique_ptr<MusicPlayer> m_player;
+    std::vector<std::string> m_media;
+    std::mt19937 m_random;
+
+    // 当前采样窗口内各阶段的延迟（毫秒），窗口开始时预留容量
+    std::vector<double> m_latencies[STAGE_COUNT];
+    std::vector<Sample> m_samples;
+
+    uint64_t m_lastAllocations;
+    int m_lastSampleCycle;
+    int m_failures;
+    int m_seekTimeouts;
+};
+
+#endif // SOAKTEST_H
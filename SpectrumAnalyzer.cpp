@@ -0,0 +1,186 @@
+#include "SpectrumAnalyzer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const float kFloorDb = -90.0f;
+
+float toDb(float amplitude) {
+    if (amplitude <= 0.0f) {
+        return kFloorDb;
+    }
+    return std::max(kFloorDb, 20.0f * std::log10(amplitude));
+}
+
+} // namespace
+
+SpectrumAnalyzer::SpectrumAnalyzer()
+    : m_ring(RING_SIZE, 0.0f)
+    , m_ringHead(0)
+    , m_ringTail(0)
+    , m_sampleRate(44100)
+    , m_running(false)
+    , m_fft(FFT_SIZE)
+    , m_window(makeHannWindow(FFT_SIZE))
+    , m_history(FFT_SIZE, 0.0f)
+    , m_windowed(FFT_SIZE, 0.0f)
+    , m_scratch(FFT_SIZE * 2, 0.0f)
+    , m_magnitudes(FFT_SIZE / 2 + 1, 0.0f)
+    , m_sequence(0)
+    , m_blocks(0)
+    , m_frames(0)
+    , m_droppedFrames(0)
+    , m_tapNanos(0)
+{
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    stop();
+}
+
+void SpectrumAnalyzer::start() {
+    if (m_running.exchange(true)) {
+        return;
+    }
+    m_thread = std::thread(&SpectrumAnalyzer::analysisLoop, this);
+}
+
+void SpectrumAnalyzer::stop() {
+    m_running.store(false);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void SpectrumAnalyzer::setSampleRate(int sampleRate) {
+    if (sampleRate > 0) {
+        m_sampleRate.store(sampleRate);
+    }
+}
+
+void SpectrumAnalyzer::push(const int16_t* samples, int frames, int channels) {
+    auto start = std::chrono::steady_clock::now();
+
+    uint32_t tail = m_ringTail.load(std::memory_order_relaxed);
+    uint32_t head = m_ringHead.load(std::memory_order_acquire);
+    uint32_t space = RING_SIZE - (tail - head);
+    int count = std::min(frames, static_cast<int>(space));
+
+    // Downmix to mono while copying
+    const float scale = 1.0f / (32768.0f * channels);
+    float* ring = m_ring.data();
+    for (int i = 0; i < count; i++) {
+        int sum = 0;
+        for (int c = 0; c < channels; c++) {
+            sum += samples[i * channels + c];
+        }
+        ring[(tail + i) & (RING_SIZE - 1)] = sum * scale;
+    }
+    m_ringTail.store(tail + count, std::memory_order_release);
+
+    // Single writer: plain load/store keeps the counters free of locked RMWs
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    m_blocks.store(m_blocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_frames.store(m_frames.load(std::memory_order_relaxed) + frames, std::memory_order_relaxed);
+    m_droppedFrames.store(m_droppedFrames.load(std::memory_order_relaxed) + (frames - count),
+                          std::memory_order_relaxed);
+    m_tapNanos.store(m_tapNanos.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+}
+
+bool SpectrumAnalyzer::readSnapshot(Snapshot& snapshot) {
+    if (!m_snapshots.update()) {
+        return false;
+    }
+    snapshot = m_snapshots.readBuffer();
+    return true;
+}
+
+SpectrumAnalyzer::TapStats SpectrumAnalyzer::getTapStats() const {
+    TapStats stats;
+    stats.blocks = m_blocks.load(std::memory_order_relaxed);
+    stats.frames = m_frames.load(std::memory_order_relaxed);
+    stats.droppedFrames = m_droppedFrames.load(std::memory_order_relaxed);
+    stats.tapNanos = m_tapNanos.load(std::memory_order_relaxed);
+    stats.sampleRate = m_sampleRate.load();
+    return stats;
+}
+
+void SpectrumAnalyzer::analysisLoop() {
+    while (m_running.load()) {
+        uint32_t head = m_ringHead.load(std::memory_order_relaxed);
+        uint32_t tail = m_ringTail.load(std::memory_order_acquire);
+        uint32_t available = tail - head;
+
+        if (available < static_cast<uint32_t>(HOP_SIZE)) {
+            // The producer never signals, so poll
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+
+        // Fell behind (e.g. after a stall): refill the whole window from the
+        // most recent audio. Sliding one hop would splice audio from before
+        // the gap onto audio after it, and the jump leaks across the spectrum.
+        int incomingCount = HOP_SIZE;
+        if (available > static_cast<uint32_t>(FFT_SIZE * 2)) {
+            head = tail - FFT_SIZE;
+            incomingCount = FFT_SIZE;
+        } else {
+            std::memmove(m_history.data(), m_history.data() + HOP_SIZE,
+                         (FFT_SIZE - HOP_SIZE) * sizeof(float));
+        }
+
+        float* incoming = m_history.data() + (FFT_SIZE - incomingCount);
+        for (int i = 0; i < incomingCount; i++) {
+            incoming[i] = m_ring[(head + i) & (RING_SIZE - 1)];
+        }
+        m_ringHead.store(head + incomingCount, std::memory_order_release);
+
+        analyze(m_sampleRate.load());
+    }
+}
+
+void SpectrumAnalyzer::analyze(int sampleRate) {
+    for (int i = 0; i < FFT_SIZE; i++) {
+        m_windowed[i] = m_history[i] * m_window[i];
+    }
+    m_fft.magnitudes(m_windowed.data(), m_scratch.data(), m_magnitudes.data());
+
+    Snapshot& snapshot = m_snapshots.writeBuffer();
+
+    // A full-scale sine peaks at N/4 through a Hann window
+    const float normalize = 4.0f / FFT_SIZE;
+    const double nyquist = sampleRate / 2.0;
+    const double lowest = 20.0;
+    const int lastBin = FFT_SIZE / 2;
+
+    for (int b = 0; b < BAND_COUNT; b++) {
+        double fLow = lowest * std::pow(nyquist / lowest, static_cast<double>(b) / BAND_COUNT);
+        double fHigh = lowest * std::pow(nyquist / lowest, static_cast<double>(b + 1) / BAND_COUNT);
+        int binLow = std::clamp(static_cast<int>(fLow * FFT_SIZE / sampleRate), 1, lastBin);
+        int binHigh = std::clamp(static_cast<int>(fHigh * FFT_SIZE / sampleRate), binLow + 1, lastBin + 1);
+
+        float peak = 0.0f;
+        for (int bin = binLow; bin < binHigh; bin++) {
+            peak = std::max(peak, m_magnitudes[bin]);
+        }
+        snapshot.bands[b] = toDb(peak * normalize);
+    }
+
+    // Levels over the newest hop
+    float peak = 0.0f;
+    double sumSquares = 0.0;
+    const float* recent = m_history.data() + (FFT_SIZE - HOP_SIZE);
+    for (int i = 0; i < HOP_SIZE; i++) {
+        peak = std::max(peak, std::fabs(recent[i]));
+        sumSquares += recent[i] * recent[i];
+    }
+    snapshot.peakDb = toDb(peak);
+    snapshot.rmsDb = toDb(static_cast<float>(std::sqrt(sumSquares / HOP_SIZE)));
+    snapshot.sequence = ++m_sequence;
+
+    m_snapshots.publish();
+}
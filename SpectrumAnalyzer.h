@@ -0,0 +1,86 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include "Fft.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Live spectrum and level meter fed from the PCM path. The decoding thread
+// only downmixes each block into a lock-free ring (dropping on overflow);
+// a separate thread runs windowed FFTs and publishes band snapshots that the
+// UI picks up wait-free.
+class SpectrumAnalyzer {
+public:
+    static constexpr int BAND_COUNT = 32;
+    static constexpr int FFT_SIZE = 2048;
+    static constexpr int HOP_SIZE = 1024;
+
+    struct Snapshot {
+        float bands[BAND_COUNT];  // dBFS, -90 to 0, log-spaced 20 Hz to Nyquist
+        float peakDb;
+        float rmsDb;
+        uint64_t sequence;
+    };
+
+    // Cost of push() on the decoding thread
+    struct TapStats {
+        uint64_t blocks;
+        uint64_t frames;
+        uint64_t droppedFrames;
+        uint64_t tapNanos;
+        int sampleRate;
+    };
+
+    SpectrumAnalyzer();
+    ~SpectrumAnalyzer();
+
+    void start();
+    void stop();
+
+    void setSampleRate(int sampleRate);
+
+    // Decoding thread: wait-free, no allocation
+    void push(const int16_t* samples, int frames, int channels);
+
+    // UI thread (single reader): returns false if nothing new since last call
+    bool readSnapshot(Snapshot& snapshot);
+
+    TapStats getTapStats() const;
+
+private:
+    static constexpr uint32_t RING_SIZE = 1 << 15;
+
+    void analysisLoop();
+    void analyze(int sampleRate);
+
+    // 解码线程 -> 分析线程的单生产者单消费者环形缓冲区（单声道）
+    std::vector<float> m_ring;
+    std::atomic<uint32_t> m_ringHead;
+    std::atomic<uint32_t> m_ringTail;
+
+    std::atomic<int> m_sampleRate;
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+
+    // 分析线程状态（预分配）
+    Fft m_fft;
+    std::vector<float> m_window;
+    std::vector<float> m_history;
+    std::vector<float> m_windowed;
+    std::vector<float> m_scratch;
+    std::vector<float> m_magnitudes;
+    uint64_t m_sequence;
+
+    TripleBuffer<Snapshot> m_snapshots;
+
+    // 统计数据
+    std::atomic<uint64_t> m_blocks;
+    std::atomic<uint64_t> m_frames;
+    std::atomic<uint64_t> m_droppedFrames;
+    std::atomic<uint64_t> m_tapNanos;
+};
+
+#endif // SPECTRUMANALYZER_H
@@ -0,0 +1,854 @@
+#include "StreamServer.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0   // macOS: SO_NOSIGPIPE is set per socket instead
+#endif
+
+namespace {
+
+struct FormatInfo {
+    StreamServer::Format format;
+    const char* name;
+    const char* encoder;   // nullptr = raw PCM, no encoder or muxer
+    const char* muxer;
+    const char* contentType;
+    int sampleRate;
+    AVSampleFormat sampleFormat;
+};
+
+const FormatInfo kFormats[] = {
+    { StreamServer::Format::OPUS, "opus", "libopus",    "ogg", "audio/ogg",  48000, AV_SAMPLE_FMT_FLT  },
+    { StreamServer::Format::MP3,  "mp3",  "libmp3lame", "mp3", "audio/mpeg", 44100, AV_SAMPLE_FMT_FLTP },
+    { StreamServer::Format::PCM,  "pcm",  nullptr,      nullptr,
+      "audio/L16;rate=44100;channels=2", 44100, AV_SAMPLE_FMT_S16 },
+};
+
+const FormatInfo& formatInfo(StreamServer::Format format) {
+    for (const auto& info : kFormats) {
+        if (info.format == format) return info;
+    }
+    return kFormats[0];
+}
+
+// Keeps listeners connected through pauses with real-time silence
+const auto kIdleBeforeSilence = std::chrono::milliseconds(250);
+
+// A client whose socket has not accepted a byte for this long is dropped
+const auto kStallTimeout = std::chrono::seconds(10);
+
+// Time from accept to a complete request; trickling bytes does not extend it
+const auto kRequestTimeout = std::chrono::seconds(5);
+
+const size_t kMaxRequestSize = 8192;
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool wouldBlock(int error) {
+    return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+}
+
+} // namespace
+
+struct StreamServer::Client {
+    int fd = -1;
+    std::string request;
+    bool streaming = false;
+    bool closeWhenSent = false;
+    bool closed = false;
+
+    // Response headers and stream header, sent before any live chunk
+    ChunkPtr preamble[2];
+    int preambleIndex = 2;
+
+    ChunkPtr current;
+    size_t offset = 0;
+    uint64_t nextSequence = 0;
+    std::chrono::steady_clock::time_point lastProgress;
+};
+
+StreamServer::StreamServer(const Options& options)
+    : m_options(options)
+    , m_running(false)
+    , m_ring(static_cast<size_t>(RING_FRAMES) * 2, 0)
+    , m_ringHead(0)
+    , m_ringTail(0)
+    , m_sampleRate(44100)
+    , m_codec(nullptr)
+    , m_encoder(nullptr)
+    , m_output(nullptr)
+    , m_swr(nullptr)
+    , m_fifo(nullptr)
+    , m_frame(nullptr)
+    , m_packet(nullptr)
+    , m_convertData(nullptr)
+    , m_convertCapacity(0)
+    , m_outputRate(0)
+    , m_outputFormat(AV_SAMPLE_FMT_NONE)
+    , m_samplesEncoded(0)
+    , m_chunkSequence(0)
+    , m_liveSequence(0)
+    , m_listenFd(-1)
+    , m_wakeFds{-1, -1}
+    , m_clientCount(0)
+    , m_totalClients(0)
+    , m_bytesEncoded(0)
+    , m_bytesSent(0)
+    , m_skippedChunks(0)
+    , m_droppedClients(0)
+    , m_droppedFrames(0)
+    , m_publishedChunks(0)
+{
+}
+
+StreamServer::~StreamServer() {
+    stop();
+}
+
+void StreamServer::setOptions(const Options& options) {
+    if (!m_running.load()) {
+        m_options = options;
+    }
+}
+
+bool StreamServer::parseFormat(const std::string& name, Format& format) {
+    for (const auto& info : kFormats) {
+        if (name == info.name) {
+            format = info.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StreamServer::start() {
+    if (m_running.load()) {
+        return true;
+    }
+
+    if (!openEncoder()) {
+        closeEncoder();
+        return false;
+    }
+    if (!openListener()) {
+        closeEncoder();
+        return false;
+    }
+
+    const FormatInfo& info = formatInfo(m_options.format);
+    std::string response = std::string("HTTP/1.1 200 OK\r\n") +
+                           "Content-Type: " + info.contentType + "\r\n"
+                           "Transfer-Encoding: chunked\r\n"
+                           "Cache-Control: no-cache, no-store\r\n"
+                           "Access-Control-Allow-Origin: *\r\n"
+                           "Connection: close\r\n\r\n";
+    std::string badRequest = "HTTP/1.1 405 Method Not Allowed\r\n"
+                             "Allow: GET\r\n"
+                             "Content-Length: 0\r\n"
+                             "Connection: close\r\n\r\n";
+    auto makeChunk = [](const std::string& text) {
+        auto chunk = std::make_shared<Chunk>();
+        chunk->bytes.assign(text.begin(), text.end());
+        return ChunkPtr(std::move(chunk));
+    };
+    m_response = makeChunk(response);
+    m_badRequest = makeChunk(badRequest);
+
+    // Discard audio left from a previous run; only the consumer side moves
+    m_ringHead.store(m_ringTail.load());
+    m_chunkSequence = 0;
+    m_liveSequence = 0;
+    m_live.assign(CHUNK_RING, nullptr);
+
+    m_running.store(true);
+    m_encoderThread = std::thread(&StreamServer::encoderLoop, this);
+    m_networkThread = std::thread(&StreamServer::networkLoop, this);
+
+    std::cout << "Streaming " << info.name << " on http://0.0.0.0:" << m_options.port
+              << "/" << std::endl;
+    return true;
+}
+
+void StreamServer::stop() {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    wake();
+    if (m_encoderThread.joinable()) {
+        m_encoderThread.join();
+    }
+    if (m_networkThread.joinable()) {
+        m_networkThread.join();
+    }
+
+    close(m_listenFd);
+    close(m_wakeFds[0]);
+    close(m_wakeFds[1]);
+    m_listenFd = m_wakeFds[0] = m_wakeFds[1] = -1;
+
+    closeEncoder();
+    for (auto& chunk : m_chunks) {
+        chunk.reset();
+    }
+    m_live.clear();
+    m_streamHeader.reset();
+}
+
+bool StreamServer::isRunning() const {
+    return m_running.load();
+}
+
+void StreamServer::setSampleRate(int sampleRate) {
+    if (sampleRate > 0) {
+        m_sampleRate.store(sampleRate);
+    }
+}
+
+void StreamServer::setDownmix(const ChannelMatrix& matrix) {
+    Downmix& downmix = m_downmix.writeBuffer();
+    const int inputs = matrix.inputChannels();
+    downmix.channels = matrix.outputChannels() == 2 && inputs <= MAX_CHANNELS ? inputs : 0;
+    for (int o = 0; o < 2; o++) {
+        for (int i = 0; i < MAX_CHANNELS; i++) {
+            downmix.gains[o][i] = matrix.coefficient(o, i);
+        }
+    }
+    m_downmix.publish();
+}
+
+void StreamServer::push(const int16_t* samples, int frames, int channels) {
+    if (!m_running.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    uint32_t tail = m_ringTail.load(std::memory_order_relaxed);
+    uint32_t head = m_ringHead.load(std::memory_order_acquire);
+    uint32_t space = RING_FRAMES - (tail - head);
+    int count = std::min(frames, static_cast<int>(space));
+
+    m_downmix.update();
+    const Downmix& downmix = m_downmix.readBuffer();
+
+    // The stream is always stereo: mono is duplicated, stereo copied and
+    // anything wider folded down with the player's matrix
+    int16_t* ring = m_ring.data();
+    if (channels > 2 && downmix.channels == channels) {
+        for (int i = 0; i < count; i++) {
+            const int16_t* frame = samples + i * channels;
+            uint32_t index = ((tail + i) & (RING_FRAMES - 1)) * 2;
+            for (int o = 0; o < 2; o++) {
+                float sum = 0.0f;
+                for (int c = 0; c < channels; c++) {
+                    sum += downmix.gains[o][c] * frame[c];
+                }
+                ring[index + o] = static_cast<int16_t>(std::lrintf(std::max(-32768.0f, std::min(32767.0f, sum))));
+            }
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            const int16_t* frame = samples + i * channels;
+            uint32_t index = ((tail + i) & (RING_FRAMES - 1)) * 2;
+            ring[index] = frame[0];
+            ring[index + 1] = channels > 1 ? frame[1] : frame[0];
+        }
+    }
+    m_ringTail.store(tail + count, std::memory_order_release);
+
+    if (count < frames) {
+        m_droppedFrames.store(m_droppedFrames.load(std::memory_order_relaxed) + (frames - count),
+                              std::memory_order_relaxed);
+    }
+}
+
+StreamServer::Stats StreamServer::getStats() const {
+    Stats stats;
+    stats.clients = m_clientCount.load();
+    stats.totalClients = m_totalClients.load();
+    stats.chunks = m_publishedChunks.load();
+    stats.bytesEncoded = m_bytesEncoded.load();
+    stats.bytesSent = m_bytesSent.load();
+    stats.skippedChunks = m_skippedChunks.load();
+    stats.droppedClients = m_droppedClients.load();
+    stats.droppedFrames = m_droppedFrames.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// ---------------------------------------------------------------------------
+// Encoder thread
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+int StreamServer::writeOutput(void* opaque, const uint8_t* data, int size) {
+#else
+int StreamServer::writeOutput(void* opaque, uint8_t* data, int size) {
+#endif
+    auto* server = static_cast<StreamServer*>(opaque);
+    server->m_pending.insert(server->m_pending.end(), data, data + size);
+    return size;
+}
+
+bool StreamServer::openEncoder() {
+    const FormatInfo& info = formatInfo(m_options.format);
+    m_outputRate = info.sampleRate;
+    m_outputFormat = info.sampleFormat;
+    m_samplesEncoded = 0;
+    m_pending.clear();
+
+    if (!info.encoder) {
+        return true;
+    }
+
+    m_codec = avcodec_find_encoder_by_name(info.encoder);
+    if (!m_codec) {
+        std::cerr << "Encoder not found: " << info.encoder << std::endl;
+        return false;
+    }
+
+    m_encoder = avcodec_alloc_context3(m_codec);
+    if (!m_encoder) {
+        std::cerr << "Failed to allocate stream encoder" << std::endl;
+        return false;
+    }
+    AVChannelLayout stereo = AV_CHANNEL_LAYOUT_STEREO;
+    av_channel_layout_copy(&m_encoder->ch_layout, &stereo);
+    m_encoder->sample_fmt = m_outputFormat;
+    m_encoder->sample_rate = m_outputRate;
+    m_encoder->bit_rate = m_options.bitRate;
+    m_encoder->time_base = AVRational{1, m_outputRate};
+
+    if (avformat_alloc_output_context2(&m_output, nullptr, info.muxer, nullptr) < 0 || !m_output) {
+        std::cerr << "Failed to create " << info.muxer << " muxer" << std::endl;
+        return false;
+    }
+    if (m_output->oformat->flags & AVFMT_GLOBALHEADER) {
+        m_encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    if (avcodec_open2(m_encoder, m_codec, nullptr) < 0) {
+        std::cerr << "Failed to open encoder: " << info.encoder << std::endl;
+        return false;
+    }
+
+    AVStream* stream = avformat_new_stream(m_output, nullptr);
+    if (!stream || avcodec_parameters_from_context(stream->codecpar, m_encoder) < 0) {
+        std::cerr << "Failed to create stream" << std::endl;
+        return false;
+    }
+    stream->time_base = m_encoder->time_base;
+
+    // The muxer writes into m_pending; whatever one flush produces becomes a chunk
+    const int bufferSize = 4096;
+    unsigned char* buffer = static_cast<unsigned char*>(av_malloc(bufferSize));
+    if (!buffer) {
+        std::cerr << "Failed to allocate stream buffer" << std::endl;
+        return false;
+    }
+    m_output->pb = avio_alloc_context(buffer, bufferSize, 1, this, nullptr, &StreamServer::writeOutput, nullptr);
+    if (!m_output->pb) {
+        av_free(buffer);
+        std::cerr << "Failed to allocate stream I/O context" << std::endl;
+        return false;
+    }
+    m_output->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    // Short Ogg pages keep latency and skip-ahead granularity low; MP3 gets
+    // no Xing/ID3 header since the stream has no end
+    AVDictionary* muxerOptions = nullptr;
+    av_dict_set(&muxerOptions, "page_duration", "100000", 0);
+    av_dict_set(&muxerOptions, "write_xing", "0", 0);
+    av_dict_set(&muxerOptions, "id3v2_version", "0", 0);
+    int ret = avformat_write_header(m_output, &muxerOptions);
+    av_dict_free(&muxerOptions);
+    if (ret < 0) {
+        std::cerr << "Failed to write stream header" << std::endl;
+        return false;
+    }
+    avio_flush(m_output->pb);
+
+    // Sent to every client ahead of the live chunks (Ogg identification pages)
+    m_streamHeader = takePending();
+
+    int frameSize = m_encoder->frame_size > 0 ? m_encoder->frame_size : BLOCK_FRAMES;
+    m_fifo = av_audio_fifo_alloc(m_outputFormat, 2, frameSize * 2);
+    m_frame = av_frame_alloc();
+    m_packet = av_packet_alloc();
+    if (!m_fifo || !m_frame || !m_packet) {
+        std::cerr << "Failed to allocate stream buffers" << std::endl;
+        return false;
+    }
+    m_frame->nb_samples = frameSize;
+    m_frame->format = m_outputFormat;
+    m_frame->sample_rate = m_outputRate;
+    av_channel_layout_copy(&m_frame->ch_layout, &stereo);
+    if (av_frame_get_buffer(m_frame, 0) < 0) {
+        std::cerr << "Failed to allocate stream frame" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void StreamServer::closeEncoder() {
+    if (m_convertData) {
+        av_freep(&m_convertData[0]);
+        av_freep(&m_convertData);
+    }
+    m_convertCapacity = 0;
+    av_frame_free(&m_frame);
+    av_packet_free(&m_packet);
+    if (m_fifo) {
+        av_audio_fifo_free(m_fifo);
+        m_fifo = nullptr;
+    }
+    swr_free(&m_swr);
+    avcodec_free_context(&m_encoder);
+    if (m_output) {
+        if (m_output->pb) {
+            av_freep(&m_output->pb->buffer);
+            avio_context_free(&m_output->pb);
+        }
+        avformat_free_context(m_output);
+        m_output = nullptr;
+    }
+    m_codec = nullptr;
+    m_pending.clear();
+}
+
+bool StreamServer::configureResampler(int inputRate) {
+    swr_free(&m_swr);
+    AVChannelLayout stereo = AV_CHANNEL_LAYOUT_STEREO;
+    int ret = swr_alloc_set_opts2(&m_swr,
+                                  &stereo, m_outputFormat, m_outputRate,
+                                  &stereo, AV_SAMPLE_FMT_S16, inputRate,
+                                  0, nullptr);
+    return ret >= 0 && swr_init(m_swr) >= 0;
+}
+
+bool StreamServer::encodeBlock(const int16_t* samples, int frames) {
+    int outSamples = swr_get_out_samples(m_swr, frames);
+    if (outSamples > m_convertCapacity) {
+        if (m_convertData) {
+            av_freep(&m_convertData[0]);
+            av_freep(&m_convertData);
+        }
+        m_convertData = static_cast<uint8_t**>(av_malloc(2 * sizeof(uint8_t*)));
+        if (!m_convertData ||
+            av_samples_alloc(m_convertData, nullptr, 2, outSamples, m_outputFormat, 0) < 0) {
+            av_freep(&m_convertData);
+            m_convertCapacity = 0;
+            return false;
+        }
+        m_convertCapacity = outSamples;
+    }
+
+    const uint8_t* input[1] = { reinterpret_cast<const uint8_t*>(samples) };
+    int converted = swr_convert(m_swr, m_convertData, outSamples, input, frames);
+    if (converted < 0) {
+        return false;
+    }
+
+    if (!m_encoder) {
+        // audio/L16 is big-endian
+        const uint8_t* bytes = m_convertData[0];
+        size_t size = static_cast<size_t>(converted) * 2 * sizeof(int16_t);
+        size_t start = m_pending.size();
+        m_pending.resize(start + size);
+        for (size_t i = 0; i < size; i += 2) {
+            m_pending[start + i] = bytes[i + 1];
+            m_pending[start + i + 1] = bytes[i];
+        }
+        publishPending();
+        return true;
+    }
+
+    if (av_audio_fifo_write(m_fifo, reinterpret_cast<void**>(m_convertData), converted) < converted) {
+        return false;
+    }
+
+    AVStream* stream = m_output->streams[0];
+    while (av_audio_fifo_size(m_fifo) >= m_frame->nb_samples) {
+        if (av_frame_make_writable(m_frame) < 0 ||
+            av_audio_fifo_read(m_fifo, reinterpret_cast<void**>(m_frame->data), m_frame->nb_samples) <
+                m_frame->nb_samples) {
+            return false;
+        }
+        m_frame->pts = m_samplesEncoded;
+        m_samplesEncoded += m_frame->nb_samples;
+
+        if (avcodec_send_frame(m_encoder, m_frame) < 0) {
+            return false;
+        }
+        int ret;
+        while ((ret = avcodec_receive_packet(m_encoder, m_packet)) >= 0) {
+            m_packet->stream_index = stream->index;
+            av_packet_rescale_ts(m_packet, m_encoder->time_base, stream->time_base);
+            if (av_interleaved_write_frame(m_output, m_packet) < 0) {
+                return false;
+            }
+        }
+        if (ret != AVERROR(EAGAIN)) {
+            return false;
+        }
+    }
+
+    avio_flush(m_output->pb);
+    publishPending();
+    return true;
+}
+
+StreamServer::ChunkPtr StreamServer::takePending() {
+    if (m_pending.empty()) {
+        return nullptr;
+    }
+
+    // Chunked transfer framing is added once here, not per client
+    char prefix[24];
+    int prefixLength = snprintf(prefix, sizeof(prefix), "%zx\r\n", m_pending.size());
+    auto chunk = std::make_shared<Chunk>();
+    chunk->bytes.reserve(prefixLength + m_pending.size() + 2);
+    chunk->bytes.insert(chunk->bytes.end(), prefix, prefix + prefixLength);
+    chunk->bytes.insert(chunk->bytes.end(), m_pending.begin(), m_pending.end());
+    chunk->bytes.push_back('\r');
+    chunk->bytes.push_back('\n');
+
+    m_bytesEncoded.fetch_add(m_pending.size(), std::memory_order_relaxed);
+    m_pending.clear();
+    return chunk;
+}
+
+void StreamServer::publishPending() {
+    ChunkPtr chunk = takePending();
+    if (!chunk) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_chunkMutex);
+        m_chunks[m_chunkSequence % CHUNK_RING] = std::move(chunk);
+        m_chunkSequence++;
+    }
+    m_publishedChunks.fetch_add(1, std::memory_order_relaxed);
+    wake();
+}
+
+void StreamServer::encoderLoop() {
+    std::vector<int16_t> block(static_cast<size_t>(BLOCK_FRAMES) * 2);
+    int inputRate = 0;
+    auto lastAudio = std::chrono::steady_clock::now();
+
+    while (m_running.load()) {
+        int rate = m_sampleRate.load();
+        if (rate != inputRate) {
+            if (!configureResampler(rate)) {
+                LOG_ERROR("Stream: cannot resample from %d Hz", rate);
+                break;
+            }
+            inputRate = rate;
+        }
+
+        uint32_t head = m_ringHead.load(std::memory_order_relaxed);
+        uint32_t tail = m_ringTail.load(std::memory_order_acquire);
+
+        if (tail - head >= static_cast<uint32_t>(BLOCK_FRAMES)) {
+            for (int i = 0; i < BLOCK_FRAMES; i++) {
+                uint32_t index = ((head + i) & (RING_FRAMES - 1)) * 2;
+                block[i * 2] = m_ring[index];
+                block[i * 2 + 1] = m_ring[index + 1];
+            }
+            m_ringHead.store(head + BLOCK_FRAMES, std::memory_order_release);
+            lastAudio = std::chrono::steady_clock::now();
+        } else {
+            auto blockDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(BLOCK_FRAMES) / inputRate));
+            if (std::chrono::steady_clock::now() < lastAudio + kIdleBeforeSilence + blockDuration) {
+                // The producer never signals, so poll
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                continue;
+            }
+            std::fill(block.begin(), block.end(), 0);
+            lastAudio += blockDuration;
+        }
+
+        if (!encodeBlock(block.data(), BLOCK_FRAMES)) {
+            LOG_ERROR("Stream: encoding failed, no further audio will be sent");
+            break;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Network thread
+
+bool StreamServer::openListener() {
+    if (pipe(m_wakeFds) != 0) {
+        std::cerr << "Failed to create wake pipe: " << strerror(errno) << std::endl;
+        return false;
+    }
+    setNonBlocking(m_wakeFds[0]);
+    setNonBlocking(m_wakeFds[1]);
+
+    m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listenFd < 0) {
+        std::cerr << "Failed to create socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int enable = 1;
+    setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(m_options.port));
+
+    if (bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(m_listenFd, 128) != 0 || !setNonBlocking(m_listenFd)) {
+        std::cerr << "Cannot listen on port " << m_options.port << ": " << strerror(errno) << std::endl;
+        close(m_listenFd);
+        close(m_wakeFds[0]);
+        close(m_wakeFds[1]);
+        m_listenFd = m_wakeFds[0] = m_wakeFds[1] = -1;
+        return false;
+    }
+    return true;
+}
+
+void StreamServer::wake() {
+    char byte = 1;
+    ssize_t written = write(m_wakeFds[1], &byte, 1);
+    (void)written;  // A full pipe already guarantees a wake-up
+}
+
+bool StreamServer::refill(Client& client) {
+    if (client.current) {
+        return true;
+    }
+
+    while (client.preambleIndex < 2) {
+        ChunkPtr next = client.preamble[client.preambleIndex++];
+        if (next) {
+            client.current = std::move(next);
+            client.offset = 0;
+            return true;
+        }
+    }
+
+    if (!client.streaming || client.nextSequence >= m_liveSequence) {
+        return false;
+    }
+
+    // Chunks older than the ring are gone: skip to the live edge or drop
+    uint64_t behind = m_liveSequence - client.nextSequence;
+    if (behind > CHUNK_RING) {
+        if (m_options.dropSlowClients) {
+            client.closed = true;
+            m_droppedClients.fetch_add(1, std::memory_order_relaxed);
+            LOG_INFO("Stream: dropped slow client (%llu chunks behind)",
+                     static_cast<unsigned long long>(behind));
+            return false;
+        }
+        m_skippedChunks.fetch_add(behind - 1, std::memory_order_relaxed);
+        client.nextSequence = m_liveSequence - 1;
+    }
+
+    client.current = m_live[client.nextSequence % CHUNK_RING];
+    client.nextSequence++;
+    client.offset = 0;
+    return true;
+}
+
+void StreamServer::serviceClient(Client& client) {
+    while (refill(client)) {
+        const std::vector<uint8_t>& bytes = client.current->bytes;
+        ssize_t sent = send(client.fd, bytes.data() + client.offset, bytes.size() - client.offset,
+                            MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (!wouldBlock(errno)) {
+                client.closed = true;
+            }
+            return;
+        }
+
+        m_bytesSent.fetch_add(sent, std::memory_order_relaxed);
+        client.lastProgress = std::chrono::steady_clock::now();
+        client.offset += sent;
+        if (client.offset < bytes.size()) {
+            return;  // Socket buffer full
+        }
+        client.current.reset();
+    }
+
+    if (client.closeWhenSent) {
+        client.closed = true;
+    }
+}
+
+void StreamServer::readRequest(Client& client) {
+    char buffer[2048];
+    for (;;) {
+        ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (received == 0) {
+            client.closed = true;
+            return;
+        }
+        if (received < 0) {
+            if (!wouldBlock(errno)) {
+                client.closed = true;
+            }
+            return;
+        }
+
+        // Anything after the request line and headers is ignored
+        if (client.streaming || client.closeWhenSent) {
+            continue;
+        }
+
+        client.request.append(buffer, received);
+        if (client.request.find("\r\n\r\n") == std::string::npos) {
+            if (client.request.size() > kMaxRequestSize) {
+                client.closed = true;
+                return;
+            }
+            continue;
+        }
+
+        if (client.request.compare(0, 4, "GET ") == 0) {
+            // Join slightly behind the live edge so the player can buffer
+            client.streaming = true;
+            client.preamble[0] = m_response;
+            client.preamble[1] = m_streamHeader;
+            client.nextSequence = m_liveSequence - std::min<uint64_t>(m_liveSequence, PREROLL_CHUNKS);
+            m_totalClients.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            client.closeWhenSent = true;
+            client.preamble[0] = m_badRequest;
+            client.preamble[1] = nullptr;
+        }
+        client.preambleIndex = 0;
+        std::string().swap(client.request);
+    }
+}
+
+void StreamServer::networkLoop() {
+    std::vector<Client> clients;
+    std::vector<pollfd> fds;
+
+    while (m_running.load()) {
+        fds.clear();
+        fds.push_back({ m_wakeFds[0], POLLIN, 0 });
+        bool accepting = clients.size() < static_cast<size_t>(m_options.maxClients);
+        fds.push_back({ m_listenFd, static_cast<short>(accepting ? POLLIN : 0), 0 });
+        for (auto& client : clients) {
+            short events = POLLIN;
+            if (refill(client)) {
+                events |= POLLOUT;
+            }
+            fds.push_back({ client.fd, events, 0 });
+        }
+
+        if (poll(fds.data(), fds.size(), 100) < 0 && errno != EINTR) {
+            LOG_ERROR("Stream: poll failed: %s", strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char drain[64];
+            while (read(m_wakeFds[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+
+        // Take references to newly published chunks; no copies of the data
+        {
+            std::lock_guard<std::mutex> lock(m_chunkMutex);
+            uint64_t first = m_chunkSequence > CHUNK_RING ? m_chunkSequence - CHUNK_RING : 0;
+            for (uint64_t s = std::max(first, m_liveSequence); s < m_chunkSequence; s++) {
+                m_live[s % CHUNK_RING] = m_chunks[s % CHUNK_RING];
+            }
+            m_liveSequence = m_chunkSequence;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < clients.size(); i++) {
+            Client& client = clients[i];
+            const pollfd& fd = fds[i + 2];
+
+            if (fd.revents & (POLLERR | POLLNVAL)) {
+                client.closed = true;
+                continue;
+            }
+            if (fd.revents & (POLLIN | POLLHUP)) {
+                readRequest(client);
+            }
+
+            // Clients that were idle may have new chunks; blocked ones wait for POLLOUT
+            bool blocked = (fd.events & POLLOUT) && !(fd.revents & POLLOUT);
+            if (!client.closed && !blocked) {
+                serviceClient(client);
+            }
+
+            if (!client.closed && client.current && now - client.lastProgress > kStallTimeout) {
+                client.closed = true;
+                m_droppedClients.fetch_add(1, std::memory_order_relaxed);
+                LOG_INFO("Stream: dropped stalled client");
+            }
+
+            // Nothing is sent before the request is complete, so lastProgress
+            // is still the accept time
+            bool waitingForRequest = !client.streaming && !client.closeWhenSent;
+            if (!client.closed && waitingForRequest && now - client.lastProgress > kRequestTimeout) {
+                client.closed = true;
+                LOG_DEBUG("Stream: closed client without a complete request");
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(m_listenFd, nullptr, nullptr)) >= 0) {
+                if (clients.size() >= static_cast<size_t>(m_options.maxClients) || !setNonBlocking(fd)) {
+                    close(fd);
+                    continue;
+                }
+#ifdef SO_NOSIGPIPE
+                int enable = 1;
+                setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+                Client client;
+                client.fd = fd;
+                client.lastProgress = now;
+                clients.push_back(std::move(client));
+            }
+        }
+
+        auto closed = std::remove_if(clients.begin(), clients.end(), [](const Client& client) {
+            if (client.closed) {
+                close(client.fd);
+            }
+            return client.closed;
+        });
+        clients.erase(closed, clients.end());
+        m_clientCount.store(static_cast<int>(clients.size()));
+    }
+
+    for (auto& client : clients) {
+        close(client.fd);
+    }
+    m_clientCount.store(0);
+}
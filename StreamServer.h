@@ -0,0 +1,175 @@
+#ifndef STREAMSERVER_H
+#define STREAMSERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/audio_fifo.h>
+#include <libswresample/swresample.h>
+}
+
+#include "ChannelMatrix.h"
+#include "TripleBuffer.h"
+
+// Serves the playing stream to listeners on the LAN over HTTP chunked
+// transfer. The decoding thread drops PCM into a lock-free ring; an encoder
+// thread encodes it once into immutable, refcounted chunks; one network
+// thread writes the same chunks to every client over non-blocking sockets.
+// A client that falls a ring's length behind is skipped ahead to the live
+// edge, or dropped if configured.
+class StreamServer {
+public:
+    enum class Format {
+        OPUS,   // Ogg/Opus
+        MP3,
+        PCM     // raw audio/L16 (16-bit big-endian), 44.1 kHz stereo
+    };
+
+    struct Options {
+        Format format = Format::OPUS;
+        int port = 8000;
+        int64_t bitRate = 128000;      // bits/s, ignored for PCM
+        int maxClients = 512;
+        bool dropSlowClients = false;  // false = skip ahead instead
+    };
+
+    struct Stats {
+        int clients;
+        uint64_t totalClients;
+        uint64_t chunks;
+        uint64_t bytesEncoded;
+        uint64_t bytesSent;
+        uint64_t skippedChunks;
+        uint64_t droppedClients;
+        uint64_t droppedFrames;   // PCM lost because the encoder fell behind
+    };
+
+    explicit StreamServer(const Options& options);
+    ~StreamServer();
+
+    // Opens the encoder and the listening socket, then starts both threads
+    bool start();
+    void stop();
+    bool isRunning() const;
+
+    void setSampleRate(int sampleRate);
+
+    // Control thread: how pushed audio with more than two channels folds
+    // into the stereo stream, from a matrix built for that layout to stereo.
+    // Without one, only the first two channels are streamed.
+    void setDownmix(const ChannelMatrix& matrix);
+
+    // Decoding thread: wait-free, no allocation
+    void push(const int16_t* samples, int frames, int channels);
+
+    Stats getStats() const;
+    const Options& getOptions() const { return m_options; }
+
+    // Takes effect on the next start()
+    void setOptions(const Options& options);
+
+    static bool parseFormat(const std::string& name, Format& format);
+
+private:
+    // Published once, then only read; already framed for chunked transfer
+    struct Chunk {
+        std::vector<uint8_t> bytes;
+    };
+    using ChunkPtr = std::shared_ptr<const Chunk>;
+
+    struct Client;
+
+    static constexpr int MAX_CHANNELS = 8;
+
+    struct Downmix {
+        int channels = 0;   // input channels; 0 = none set
+        float gains[2][MAX_CHANNELS];
+    };
+
+    static constexpr uint32_t RING_FRAMES = 1 << 15;   // stereo PCM frames
+    static constexpr uint32_t CHUNK_RING = 256;
+    static constexpr uint32_t PREROLL_CHUNKS = 8;
+    static constexpr int BLOCK_FRAMES = 1024;
+
+    bool openEncoder();
+    void closeEncoder();
+    bool configureResampler(int inputRate);
+    bool encodeBlock(const int16_t* samples, int frames);
+    ChunkPtr takePending();
+    void publishPending();
+    bool openListener();
+
+    void encoderLoop();
+    void networkLoop();
+    bool refill(Client& client);
+    void serviceClient(Client& client);
+    void readRequest(Client& client);
+    void wake();
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+    static int writeOutput(void* opaque, const uint8_t* data, int size);
+#else
+    static int writeOutput(void* opaque, uint8_t* data, int size);
+#endif
+
+    Options m_options;
+    std::atomic<bool> m_running;
+
+    // 解码线程 -> 编码线程的单生产者单消费者环形缓冲区（立体声交错）
+    std::vector<int16_t> m_ring;
+    std::atomic<uint32_t> m_ringHead;
+    std::atomic<uint32_t> m_ringTail;
+    std::atomic<int> m_sampleRate;
+    TripleBuffer<Downmix> m_downmix;
+
+    // 编码器状态（仅编码线程使用）
+    const AVCodec* m_codec;
+    AVCodecContext* m_encoder;
+    AVFormatContext* m_output;
+    SwrContext* m_swr;
+    AVAudioFifo* m_fifo;
+    AVFrame* m_frame;
+    AVPacket* m_packet;
+    uint8_t** m_convertData;
+    int m_convertCapacity;
+    int m_outputRate;
+    AVSampleFormat m_outputFormat;
+    int64_t m_samplesEncoded;
+    std::vector<uint8_t> m_pending;
+
+    // 已编码数据块：编码线程写入，网络线程在锁内复制引用
+    std::mutex m_chunkMutex;
+    ChunkPtr m_chunks[CHUNK_RING];
+    uint64_t m_chunkSequence;
+    ChunkPtr m_streamHeader;
+    ChunkPtr m_response;
+    ChunkPtr m_badRequest;
+
+    // 网络（m_live 仅由网络线程访问）
+    std::vector<ChunkPtr> m_live;
+    uint64_t m_liveSequence;
+    int m_listenFd;
+    int m_wakeFds[2];
+    std::thread m_encoderThread;
+    std::thread m_networkThread;
+
+    // 统计数据
+    std::atomic<int> m_clientCount;
+    std::atomic<uint64_t> m_totalClients;
+    std::atomic<uint64_t> m_bytesEncoded;
+    std::atomic<uint64_t> m_bytesSent;
+    std::atomic<uint64_t> m_skippedChunks;
+    std::atomic<uint64_t> m_droppedClients;
+    std::atomic<uint64_t> m_droppedFrames;
+    std::atomic<uint64_t> m_publishedChunks;
+};
+
+#endif // STREAMSERVER_H
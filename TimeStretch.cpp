@@ -0,0 +1,307 @@
+#include "TimeStretch.h"
+#include "Fft.h"
+#include "SampleConvert.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define TIMESTRETCH_SSE 1
+#endif
+
+namespace {
+
+// Synthesis hop and search tolerance in milliseconds; the window is two hops
+constexpr int kHopMs = 15;
+constexpr int kSearchMs = 7;
+
+// Similarity of `candidate` to `reference`: squared normalized correlation
+// with the sign kept, so anti-phase candidates rank last. The reference
+// energy is the same for every candidate and is left out.
+float similarity(const float* reference, const float* candidate, int length) {
+    float dot = 0.0f;
+    float energy = 0.0f;
+    int i = 0;
+#ifdef TIMESTRETCH_SSE
+    __m128 dotSum = _mm_setzero_ps();
+    __m128 energySum = _mm_setzero_ps();
+    for (; i + 4 <= length; i += 4) {
+        __m128 r = _mm_loadu_ps(reference + i);
+        __m128 c = _mm_loadu_ps(candidate + i);
+        dotSum = _mm_add_ps(dotSum, _mm_mul_ps(r, c));
+        energySum = _mm_add_ps(energySum, _mm_mul_ps(c, c));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, dotSum);
+    dot = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_storeu_ps(lanes, energySum);
+    energy = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < length; i++) {
+        dot += reference[i] * candidate[i];
+        energy += candidate[i] * candidate[i];
+    }
+    return dot * std::fabs(dot) / (energy + 1e-9f * length);
+}
+
+} // namespace
+
+TimeStretch::TimeStretch()
+    : m_speed(1.0f)
+    , m_sampleRate(0)
+    , m_channels(0)
+    , m_hopFrames(0)
+    , m_windowFrames(0)
+    , m_searchFrames(0)
+    , m_capacityFrames(0)
+    , m_maxOutputFrames(0)
+    , m_inputFrames(0)
+    , m_previous(0)
+    , m_nominal(0.0)
+    , m_engaged(false)
+    , m_primed(false)
+{
+}
+
+void TimeStretch::setSpeed(float speed) {
+    speed = std::max(MIN_SPEED, std::min(MAX_SPEED, speed));
+    // Snap near-unity values so the stage can step out of the path
+    if (std::fabs(speed - 1.0f) < 0.005f) {
+        speed = 1.0f;
+    }
+    m_speed.store(speed, std::memory_order_relaxed);
+}
+
+float TimeStretch::getSpeed() const {
+    return m_speed.load(std::memory_order_relaxed);
+}
+
+int TimeStretch::maxOutputFrames() const {
+    return m_maxOutputFrames;
+}
+
+void TimeStretch::prepare(int sampleRate, int channels) {
+    m_sampleRate = sampleRate;
+    m_channels = std::max(1, channels);
+    m_hopFrames = std::max(64, sampleRate * kHopMs / 1000);
+    m_windowFrames = 2 * m_hopFrames;
+    m_searchFrames = std::max(16, sampleRate * kSearchMs / 1000);
+
+    // After compact() fewer than window + 2 * search + hop frames remain,
+    // so every refill has room for at least MAX_BLOCK frames
+    m_capacityFrames = m_windowFrames + 2 * m_searchFrames + m_hopFrames + MAX_BLOCK;
+
+    // Periodic Hann: w[i] + w[i + hop] == 1, so unshifted segments
+    // reconstruct the input exactly
+    std::vector<float> hann = makeHannWindow(m_windowFrames);
+    m_window.resize(static_cast<size_t>(m_windowFrames) * m_channels);
+    for (int i = 0; i < m_windowFrames; i++) {
+        for (int c = 0; c < m_channels; c++) {
+            m_window[static_cast<size_t>(i) * m_channels + c] = hann[i];
+        }
+    }
+
+    m_input.assign(static_cast<size_t>(m_capacityFrames) * m_channels, 0.0f);
+    m_mono.assign(m_capacityFrames, 0.0f);
+    m_overlap.assign(static_cast<size_t>(m_hopFrames) * m_channels, 0.0f);
+
+    // Worst case is the slowest speed over everything buffered plus a full
+    // block, so process() never has to grow these
+    m_maxOutputFrames = (m_capacityFrames + MAX_BLOCK) * 2 + m_windowFrames;
+    size_t outputSamples = static_cast<size_t>(m_maxOutputFrames) * m_channels;
+    m_output.assign(outputSamples, 0.0f);
+    m_outputS16.assign(outputSamples, 0);
+
+    reset();
+}
+
+void TimeStretch::reset() {
+    m_inputFrames = 0;
+    m_previous = 0;
+    m_nominal = 0.0;
+    m_engaged = false;
+    m_primed = false;
+}
+
+int TimeStretch::process(int16_t* samples, int frames, int16_t** output) {
+    const float speed = m_speed.load(std::memory_order_relaxed);
+
+    if (!m_engaged || m_capacityFrames == 0) {
+        if (speed == 1.0f || m_capacityFrames == 0) {
+            *output = samples;
+            return frames;
+        }
+        m_engaged = true;
+    }
+
+    frames = std::min(frames, MAX_BLOCK);
+    const int channels = m_channels;
+    int produced = 0;
+
+    if (speed == 1.0f) {
+        // Hand back everything still buffered, then this block untouched
+        produced = drain(m_output.data());
+        SampleConvert::toS16(m_output.data(), m_outputS16.data(), produced * channels);
+        std::memcpy(m_outputS16.data() + static_cast<size_t>(produced) * channels, samples,
+                    static_cast<size_t>(frames) * channels * sizeof(int16_t));
+        reset();
+        *output = m_outputS16.data();
+        return produced + frames;
+    }
+
+    int consumed = 0;
+    while (consumed < frames) {
+        int take = std::min(frames - consumed, m_capacityFrames - m_inputFrames);
+        float* in = m_input.data() + static_cast<size_t>(m_inputFrames) * channels;
+        SampleConvert::toFloat(samples + static_cast<size_t>(consumed) * channels, in, take * channels);
+
+        float* mono = m_mono.data() + m_inputFrames;
+        if (channels == 1) {
+            std::memcpy(mono, in, take * sizeof(float));
+        } else {
+            for (int i = 0; i < take; i++) {
+                float sum = 0.0f;
+                for (int c = 0; c < channels; c++) {
+                    sum += in[i * channels + c];
+                }
+                mono[i] = sum;
+            }
+        }
+        m_inputFrames += take;
+        consumed += take;
+
+        while (segmentReady()) {
+            runSegment(speed, m_output.data() + static_cast<size_t>(produced) * channels);
+            produced += m_hopFrames;
+        }
+        compact();
+    }
+
+    SampleConvert::toS16(m_output.data(), m_outputS16.data(), produced * channels);
+    *output = m_outputS16.data();
+    return produced;
+}
+
+int TimeStretch::flush(int16_t** output) {
+    if (!m_engaged || m_capacityFrames == 0) {
+        return 0;
+    }
+
+    const int produced = drain(m_output.data());
+    SampleConvert::toS16(m_output.data(), m_outputS16.data(), produced * m_channels);
+    reset();
+    *output = m_outputS16.data();
+    return produced;
+}
+
+bool TimeStretch::segmentReady() const {
+    if (!m_primed) {
+        return m_inputFrames >= m_windowFrames;
+    }
+    int center = static_cast<int>(std::lround(m_nominal));
+    return center + m_searchFrames + m_windowFrames <= m_inputFrames;
+}
+
+void TimeStretch::runSegment(float speed, float* out) {
+    int start = 0;
+    const size_t half = static_cast<size_t>(m_hopFrames) * m_channels;
+
+    if (!m_primed) {
+        // Pretend the previous segment was this same audio so the first
+        // hop reproduces the input instead of fading in from silence
+        const float* x = m_input.data();
+        for (size_t i = 0; i < half; i++) {
+            m_overlap[i] = m_window[half + i] * x[i];
+        }
+        m_primed = true;
+    } else {
+        start = findOffset(static_cast<int>(std::lround(m_nominal)), m_previous + m_hopFrames);
+    }
+
+    const float* x = m_input.data() + static_cast<size_t>(start) * m_channels;
+    const float* window = m_window.data();
+    float* overlap = m_overlap.data();
+    for (size_t i = 0; i < half; i++) {
+        out[i] = overlap[i] + window[i] * x[i];
+    }
+    for (size_t i = 0; i < half; i++) {
+        overlap[i] = window[half + i] * x[half + i];
+    }
+
+    m_previous = start;
+    m_nominal += m_hopFrames * static_cast<double>(speed);
+}
+
+int TimeStretch::findOffset(int center, int target) const {
+    // The reference is what would have followed the previous segment
+    const float* reference = m_mono.data() + target;
+    const float* mono = m_mono.data();
+    const int length = m_hopFrames;
+    const int low = std::max(0, center - m_searchFrames);
+    const int high = center + m_searchFrames;
+
+    // Coarse pass on every other lag, then refine around the best one.
+    // Ties keep the nominal position so silence does not drift.
+    int best = center;
+    float bestScore = similarity(reference, mono + center, length);
+    for (int position = low; position <= high; position += 2) {
+        float score = similarity(reference, mono + position, length);
+        if (score > bestScore) {
+            bestScore = score;
+            best = position;
+        }
+    }
+    const int coarse = best;
+    for (int position = coarse - 1; position <= coarse + 1; position += 2) {
+        if (position < low || position > high) {
+            continue;
+        }
+        float score = similarity(reference, mono + position, length);
+        if (score > bestScore) {
+            bestScore = score;
+            best = position;
+        }
+    }
+    return best;
+}
+
+int TimeStretch::drain(float* out) {
+    const int channels = m_channels;
+    if (!m_primed) {
+        std::memcpy(out, m_input.data(), static_cast<size_t>(m_inputFrames) * channels * sizeof(float));
+        return m_inputFrames;
+    }
+
+    // The pending half window plus its complement is exactly the input
+    const int start = m_previous + m_hopFrames;
+    const size_t half = static_cast<size_t>(m_hopFrames) * channels;
+    const float* x = m_input.data() + static_cast<size_t>(start) * channels;
+    for (size_t i = 0; i < half; i++) {
+        out[i] = m_overlap[i] + m_window[i] * x[i];
+    }
+    const int rest = m_inputFrames - start - m_hopFrames;
+    std::memcpy(out + half, x + half, static_cast<size_t>(rest) * channels * sizeof(float));
+    return m_hopFrames + rest;
+}
+
+void TimeStretch::compact() {
+    if (!m_primed) {
+        return;
+    }
+
+    int keep = std::min(m_previous + m_hopFrames,
+                        static_cast<int>(std::lround(m_nominal)) - m_searchFrames);
+    keep = std::max(0, std::min(keep, m_inputFrames));
+    if (keep == 0) {
+        return;
+    }
+
+    const int remaining = m_inputFrames - keep;
+    std::memmove(m_input.data(), m_input.data() + static_cast<size_t>(keep) * m_channels,
+                 static_cast<size_t>(remaining) * m_channels * sizeof(float));
+    std::memmove(m_mono.data(), m_mono.data() + keep, remaining * sizeof(float));
+    m_inputFrames = remaining;
+    m_previous -= keep;
+    m_nominal -= keep;
+}
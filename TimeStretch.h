@@ -0,0 +1,79 @@
+#ifndef TIMESTRETCH_H
+#define TIMESTRETCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Tempo change without pitch change (WSOLA). Output is built from
+// Hann-windowed segments overlapped by half a window; each segment is taken
+// near its nominal position in the input, shifted within a small tolerance
+// to where it best continues the previous one (normalized cross-correlation
+// on a mono mix, SSE). Speed changes apply on the next hop and need no
+// crossfade. At 1.0x the stage drains its buffer exactly and steps out of
+// the path, so normal playback is bit-identical and has no added latency.
+class TimeStretch {
+public:
+    static constexpr float MIN_SPEED = 0.5f;
+    static constexpr float MAX_SPEED = 2.0f;
+    static constexpr int MAX_BLOCK = 8192;   // frames per process() call
+
+    TimeStretch();
+
+    // Any thread; clamped to [MIN_SPEED, MAX_SPEED]
+    void setSpeed(float speed);
+    float getSpeed() const;
+
+    // Control thread, playback not running: allocate all state here
+    void prepare(int sampleRate, int channels);
+
+    // Decoding thread: drop buffered input (e.g. after a seek)
+    void reset();
+
+    // Decoding thread. Returns the number of output frames, which may be
+    // zero while the first window fills. `output` points either at
+    // `samples` (pass-through) or at an internal buffer that stays valid
+    // until the next call. Never allocates; while engaged at most MAX_BLOCK
+    // frames are taken per call, so callers split larger blocks.
+    int process(int16_t* samples, int frames, int16_t** output);
+
+    // Decoding thread, at end of input: hands back everything still
+    // buffered, unstretched, and resets. Same `output` rules as process().
+    int flush(int16_t** output);
+
+    // After prepare(): the most frames process() or flush() can return, for
+    // sizing the buffers downstream of the stage
+    int maxOutputFrames() const;
+
+private:
+    bool segmentReady() const;
+    void runSegment(float speed, float* out);
+    int findOffset(int center, int target) const;
+    int drain(float* out);
+    void compact();
+
+    std::atomic<float> m_speed;
+
+    int m_sampleRate;
+    int m_channels;
+    int m_hopFrames;      // synthesis hop, half a window
+    int m_windowFrames;
+    int m_searchFrames;   // +/- tolerance around the nominal position
+    int m_capacityFrames;
+    int m_maxOutputFrames;
+
+    // 解码线程状态（prepare 之后不再分配）
+    std::vector<float> m_window;    // 按声道展开的交错窗函数
+    std::vector<float> m_input;     // 交错浮点输入
+    std::vector<float> m_mono;      // 互相关用的单声道混音
+    std::vector<float> m_overlap;   // 上一段的后半窗（已加窗）
+    std::vector<float> m_output;
+    std::vector<int16_t> m_outputS16;
+    int m_inputFrames;
+    int m_previous;       // start of the last segment in m_input
+    double m_nominal;     // where the next segment would start at this speed
+    bool m_engaged;
+    bool m_primed;
+};
+
+#endif // TIMESTRETCH_H
@@ -0,0 +1,656 @@
+#include "Transcoder.h"
+#include "AudioInput.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/audio_fifo.h>
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+namespace {
+
+struct CodecDefaults {
+    const char* name;
+    const char* encoder;
+    const char* extension;
+};
+
+// The extension picks the muxer via avformat_alloc_output_context2
+const CodecDefaults kCodecDefaults[] = {
+    { "opus",   "libopus",    "opus" },
+    { "mp3",    "libmp3lame", "mp3"  },
+    { "aac",    "aac",        "m4a"  },
+    { "flac",   "flac",       "flac" },
+    { "vorbis", "libvorbis",  "ogg"  },
+    { "wav",    "pcm_s16le",  "wav"  },
+};
+
+std::string errorString(int error) {
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {0};
+    av_strerror(error, buffer, sizeof(buffer));
+    return buffer;
+}
+
+std::string outputPathFor(const std::string& input, const std::string& outputDir,
+                          const std::string& extension) {
+    size_t slash = input.find_last_of("/\\");
+    std::string name = (slash == std::string::npos) ? input : input.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) {
+        name = name.substr(0, dot);
+    }
+
+    std::string dir = outputDir.empty() ? "." : outputDir;
+    if (dir.back() != '/') {
+        dir += '/';
+    }
+    return dir + name + "." + extension;
+}
+
+AVSampleFormat pickSampleFormat(const AVCodec* codec, const AVCodecContext* context,
+                                AVSampleFormat preferred) {
+    const AVSampleFormat* formats = nullptr;
+    int count = 0;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 13, 100)
+    const void* configs = nullptr;
+    if (avcodec_get_supported_config(context, codec, AV_CODEC_CONFIG_SAMPLE_FORMAT, 0,
+                                     &configs, &count) >= 0) {
+        formats = static_cast<const AVSampleFormat*>(configs);
+    }
+#else
+    (void)context;
+    formats = codec->sample_fmts;
+    while (formats && formats[count] != AV_SAMPLE_FMT_NONE) count++;
+#endif
+    if (!formats || count == 0) {
+        return preferred;
+    }
+    for (int i = 0; i < count; i++) {
+        if (formats[i] == preferred) return preferred;
+    }
+    return formats[0];
+}
+
+int pickSampleRate(const AVCodec* codec, const AVCodecContext* context, int preferred) {
+    const int* rates = nullptr;
+    int count = 0;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 13, 100)
+    const void* configs = nullptr;
+    if (avcodec_get_supported_config(context, codec, AV_CODEC_CONFIG_SAMPLE_RATE, 0,
+                                     &configs, &count) >= 0) {
+        rates = static_cast<const int*>(configs);
+    }
+#else
+    (void)context;
+    rates = codec->supported_samplerates;
+    while (rates && rates[count] != 0) count++;
+#endif
+    if (!rates || count == 0) {
+        return preferred;
+    }
+
+    // Smallest supported rate that does not lose bandwidth, else the highest
+    int above = 0;
+    int highest = 0;
+    for (int i = 0; i < count; i++) {
+        if (rates[i] == preferred) return preferred;
+        if (rates[i] > preferred && (above == 0 || rates[i] < above)) above = rates[i];
+        highest = std::max(highest, rates[i]);
+    }
+    return above ? above : highest;
+}
+
+// The source layout if the encoder takes it, else stereo, else the largest
+// supported layout that does not add channels; swr remixes into it
+void pickChannelLayout(const AVCodec* codec, const AVCodecContext* context,
+                       const AVChannelLayout& source, AVChannelLayout* layout) {
+    const AVChannelLayout* layouts = nullptr;
+    int count = 0;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 13, 100)
+    const void* configs = nullptr;
+    if (avcodec_get_supported_config(context, codec, AV_CODEC_CONFIG_CHANNEL_LAYOUT, 0,
+                                     &configs, &count) >= 0) {
+        layouts = static_cast<const AVChannelLayout*>(configs);
+    }
+#else
+    (void)context;
+    layouts = codec->ch_layouts;
+    while (layouts && layouts[count].nb_channels != 0) count++;
+#endif
+    if (!layouts || count == 0) {
+        av_channel_layout_copy(layout, &source);
+        return;
+    }
+
+    const AVChannelLayout stereo = AV_CHANNEL_LAYOUT_STEREO;
+    const AVChannelLayout* stereoMatch = nullptr;
+    const AVChannelLayout* largest = nullptr;
+    for (int i = 0; i < count; i++) {
+        if (av_channel_layout_compare(&layouts[i], &source) == 0) {
+            av_channel_layout_copy(layout, &source);
+            return;
+        }
+        if (av_channel_layout_compare(&layouts[i], &stereo) == 0) {
+            stereoMatch = &layouts[i];
+        }
+        if (layouts[i].nb_channels <= source.nb_channels &&
+            (!largest || layouts[i].nb_channels > largest->nb_channels)) {
+            largest = &layouts[i];
+        }
+    }
+    if (stereoMatch && source.nb_channels >= 2) {
+        av_channel_layout_copy(layout, stereoMatch);
+    } else {
+        av_channel_layout_copy(layout, largest ? largest : &layouts[0]);
+    }
+}
+
+// Per-job FFmpeg state, released in one place whatever the outcome
+struct EncodeSession {
+    AudioInput input;
+    AVCodecContext* encoder = nullptr;
+    AVFormatContext* output = nullptr;
+    AVStream* stream = nullptr;
+    SwrContext* swr = nullptr;
+    AVAudioFifo* fifo = nullptr;
+    AVPacket* inputPacket = nullptr;
+    AVPacket* packet = nullptr;
+    AVFrame* decoded = nullptr;
+    AVFrame* encodeFrame = nullptr;
+    uint8_t** convertData = nullptr;
+    int convertCapacity = 0;
+    int frameSize = 0;
+    int64_t samplesWritten = 0;
+
+    ~EncodeSession() {
+        if (convertData) {
+            av_freep(&convertData[0]);
+            av_freep(&convertData);
+        }
+        av_frame_free(&encodeFrame);
+        av_frame_free(&decoded);
+        av_packet_free(&packet);
+        av_packet_free(&inputPacket);
+        if (fifo) av_audio_fifo_free(fifo);
+        swr_free(&swr);
+        avcodec_free_context(&encoder);
+        if (output) {
+            if (!(output->oformat->flags & AVFMT_NOFILE)) {
+                avio_closep(&output->pb);
+            }
+            avformat_free_context(output);
+        }
+        closeAudioInput(input);
+    }
+};
+
+// Sends one frame (nullptr flushes) and writes every packet it produces
+int encodeAndWrite(EncodeSession& session, AVFrame* frame) {
+    int ret = avcodec_send_frame(session.encoder, frame);
+    if (ret < 0 && ret != AVERROR_EOF) {
+        return ret;
+    }
+
+    AVPacket* packet = session.packet;
+    while ((ret = avcodec_receive_packet(session.encoder, packet)) >= 0) {
+        packet->stream_index = session.stream->index;
+        av_packet_rescale_ts(packet, session.encoder->time_base, session.stream->time_base);
+        ret = av_interleaved_write_frame(session.output, packet);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) ? 0 : ret;
+}
+
+// Hands full encoder frames from the FIFO to the encoder. With flush set the
+// final partial frame is sent as well.
+int drainFifo(EncodeSession& session, bool flush) {
+    while (av_audio_fifo_size(session.fifo) >= session.frameSize ||
+           (flush && av_audio_fifo_size(session.fifo) > 0)) {
+        int count = std::min(av_audio_fifo_size(session.fifo), session.frameSize);
+
+        int ret = av_frame_make_writable(session.encodeFrame);
+        if (ret < 0) {
+            return ret;
+        }
+        session.encodeFrame->nb_samples = count;
+        if (av_audio_fifo_read(session.fifo, (void**)session.encodeFrame->data, count) < count) {
+            return AVERROR(EIO);
+        }
+        session.encodeFrame->pts = session.samplesWritten;
+        session.samplesWritten += count;
+
+        ret = encodeAndWrite(session, session.encodeFrame);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+// Resamples one decoded frame (nullptr drains swr) into the FIFO
+int convertIntoFifo(EncodeSession& session, const AVFrame* frame) {
+    int inSamples = frame ? frame->nb_samples : 0;
+    int outSamples = swr_get_out_samples(session.swr, inSamples);
+    if (outSamples <= 0) {
+        return 0;
+    }
+
+    if (outSamples > session.convertCapacity) {
+        if (session.convertData) {
+            av_freep(&session.convertData[0]);
+            av_freep(&session.convertData);
+        }
+        int channels = session.encoder->ch_layout.nb_channels;
+        session.convertData = (uint8_t**)av_malloc(channels * sizeof(uint8_t*));
+        if (!session.convertData) {
+            return AVERROR(ENOMEM);
+        }
+        int ret = av_samples_alloc(session.convertData, nullptr, channels, outSamples,
+                                   session.encoder->sample_fmt, 0);
+        if (ret < 0) {
+            av_freep(&session.convertData);
+            return ret;
+        }
+        session.convertCapacity = outSamples;
+    }
+
+    int converted = swr_convert(session.swr, session.convertData, outSamples,
+                                frame ? (const uint8_t**)frame->extended_data : nullptr,
+                                inSamples);
+    if (converted < 0) {
+        return converted;
+    }
+    if (converted > 0 &&
+        av_audio_fifo_write(session.fifo, (void**)session.convertData, converted) < converted) {
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+} // namespace
+
+Transcoder::Transcoder(const Options& options)
+    : m_options(options)
+    , m_encoder(nullptr)
+    , m_nextJob(0)
+    , m_finishedJobs(0)
+{
+}
+
+bool Transcoder::resolveEncoder() {
+    const char* encoderName = m_options.codec.c_str();
+    m_extension = m_options.format;
+
+    for (const auto& defaults : kCodecDefaults) {
+        if (m_options.codec == defaults.name) {
+            encoderName = defaults.encoder;
+            if (m_extension.empty()) {
+                m_extension = defaults.extension;
+            }
+            break;
+        }
+    }
+
+    m_encoder = avcodec_find_encoder_by_name(encoderName);
+    if (!m_encoder) {
+        std::cerr << "Encoder not found: " << encoderName << std::endl;
+        return false;
+    }
+
+    if (m_extension.empty()) {
+        std::cerr << "No default container for encoder " << encoderName
+                  << ", specify an output format" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Transcoder::run(const std::vector<std::string>& inputs) {
+    if (!resolveEncoder()) {
+        return false;
+    }
+
+    m_jobs.clear();
+    for (const auto& input : inputs) {
+        auto job = std::make_unique<Job>();
+        job->input = input;
+        job->output = outputPathFor(input, m_options.outputDir, m_extension);
+        m_jobs.push_back(std::move(job));
+    }
+    m_nextJob.store(0);
+    m_finishedJobs.store(rejectUnsafeOutputs());
+
+    if (m_jobs.empty()) {
+        return true;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(m_options.outputDir, error);
+    if (error) {
+        std::cerr << "Cannot create output directory " << m_options.outputDir
+                  << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    int workers = m_options.jobs > 0 ? m_options.jobs
+                                     : static_cast<int>(std::thread::hardware_concurrency());
+    workers = std::max(1, std::min(workers, static_cast<int>(m_jobs.size())));
+
+    std::cout << "Transcoding " << m_jobs.size() << " file(s) to " << m_encoder->name
+              << " (." << m_extension << ") with " << workers << " worker(s)" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; i++) {
+        threads.emplace_back(&Transcoder::workerLoop, this);
+    }
+
+    // Report from the calling thread until every job has finished
+    {
+        std::unique_lock<std::mutex> lock(m_doneMutex);
+        while (m_finishedJobs.load() < m_jobs.size()) {
+            m_doneCondition.wait_for(lock, std::chrono::seconds(1));
+            lock.unlock();
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printProgress(elapsed, false);
+            lock.lock();
+        }
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printProgress(elapsed, true);
+
+    bool allSucceeded = true;
+    for (const auto& job : m_jobs) {
+        if (job->state.load() == JobState::FAILED) {
+            std::cerr << "Failed: " << job->input << ": " << job->error << std::endl;
+            allSucceeded = false;
+        }
+    }
+    return allSucceeded;
+}
+
+// Fails, before any worker starts, every job whose output is the same file
+// as any input or as an earlier job's output (e.g. "song.flac" and
+// "./song.flac", or the same name from two directories). Returns how many.
+size_t Transcoder::rejectUnsafeOutputs() {
+    namespace fs = std::filesystem;
+
+    auto canonical = [](const std::string& path) {
+        std::error_code error;
+        fs::path resolved = fs::weakly_canonical(path, error);
+        return error ? fs::absolute(path, error).lexically_normal().string() : resolved.string();
+    };
+
+    std::unordered_map<std::string, size_t> inputs;
+    inputs.reserve(m_jobs.size());
+    for (size_t i = 0; i < m_jobs.size(); i++) {
+        inputs.emplace(canonical(m_jobs[i]->input), i);
+    }
+
+    std::unordered_map<std::string, size_t> outputs;
+    outputs.reserve(m_jobs.size());
+    size_t rejected = 0;
+    for (size_t i = 0; i < m_jobs.size(); i++) {
+        Job& job = *m_jobs[i];
+        std::string output = canonical(job.output);
+
+        // equivalent() also catches a hard link to the input
+        std::error_code error;
+        auto input = inputs.find(output);
+        if ((input != inputs.end() && input->second == i) || fs::equivalent(job.output, job.input, error)) {
+            job.error = "output would overwrite the input";
+        } else if (input != inputs.end()) {
+            job.error = "output would overwrite input " + m_jobs[input->second]->input;
+        } else {
+            auto earlier = outputs.emplace(output, i);
+            if (!earlier.second) {
+                job.error = "output " + job.output + " is also written by " +
+                            m_jobs[earlier.first->second]->input;
+            }
+        }
+
+        if (!job.error.empty()) {
+            job.state.store(JobState::FAILED);
+            rejected++;
+        }
+    }
+    return rejected;
+}
+
+void Transcoder::workerLoop() {
+    size_t index;
+    while ((index = m_nextJob.fetch_add(1)) < m_jobs.size()) {
+        Job& job = *m_jobs[index];
+        if (job.state.load() != JobState::PENDING) {
+            continue;   // rejected up front and already counted
+        }
+        job.state.store(JobState::RUNNING);
+
+        bool ok = transcodeFile(job);
+        if (!ok && job.createdOutput) {
+            // Do not leave a truncated file behind
+            std::remove(job.output.c_str());
+        }
+        job.state.store(ok ? JobState::DONE : JobState::FAILED);
+
+        m_finishedJobs.fetch_add(1);
+        m_doneCondition.notify_one();
+    }
+}
+
+bool Transcoder::transcodeFile(Job& job) {
+    EncodeSession session;
+    if (!openAudioInput(job.input, session.input)) {
+        job.error = "cannot open input";
+        return false;
+    }
+    AVCodecContext* decoder = session.input.codecContext;
+
+    // Encoder: keep the source format, rate and layout where the codec allows
+    session.encoder = avcodec_alloc_context3(m_encoder);
+    if (!session.encoder) {
+        job.error = "cannot allocate encoder";
+        return false;
+    }
+    AVCodecContext* encoder = session.encoder;
+    encoder->sample_fmt = pickSampleFormat(m_encoder, encoder, decoder->sample_fmt);
+    encoder->sample_rate = pickSampleRate(m_encoder, encoder,
+        m_options.sampleRate > 0 ? m_options.sampleRate : decoder->sample_rate);
+    AVChannelLayout source = {};
+    if (decoder->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC) {
+        av_channel_layout_default(&source, decoder->ch_layout.nb_channels);
+    } else {
+        av_channel_layout_copy(&source, &decoder->ch_layout);
+    }
+    pickChannelLayout(m_encoder, encoder, source, &encoder->ch_layout);
+    av_channel_layout_uninit(&source);
+    if (m_options.bitRate > 0) {
+        encoder->bit_rate = m_options.bitRate;
+    }
+    encoder->time_base = AVRational{1, encoder->sample_rate};
+
+    int ret = avformat_alloc_output_context2(&session.output, nullptr, nullptr, job.output.c_str());
+    if (ret < 0 || !session.output) {
+        job.error = "cannot create output container: " + errorString(ret);
+        return false;
+    }
+    if (session.output->oformat->flags & AVFMT_GLOBALHEADER) {
+        encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    ret = avcodec_open2(encoder, m_encoder, nullptr);
+    if (ret < 0) {
+        job.error = "cannot open encoder: " + errorString(ret);
+        return false;
+    }
+
+    session.stream = avformat_new_stream(session.output, nullptr);
+    if (!session.stream ||
+        avcodec_parameters_from_context(session.stream->codecpar, encoder) < 0) {
+        job.error = "cannot create output stream";
+        return false;
+    }
+    session.stream->time_base = encoder->time_base;
+
+    if (!(session.output->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&session.output->pb, job.output.c_str(), AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            job.error = "cannot open output file: " + errorString(ret);
+            return false;
+        }
+        job.createdOutput = true;
+    }
+
+    ret = avformat_write_header(session.output, nullptr);
+    if (ret < 0) {
+        job.error = "cannot write header: " + errorString(ret);
+        return false;
+    }
+
+    // Resampler into the encoder's format
+    ret = swr_alloc_set_opts2(&session.swr,
+                              &encoder->ch_layout, encoder->sample_fmt, encoder->sample_rate,
+                              &decoder->ch_layout, decoder->sample_fmt, decoder->sample_rate,
+                              0, nullptr);
+    if (ret < 0 || swr_init(session.swr) < 0) {
+        job.error = "cannot initialize resampler";
+        return false;
+    }
+
+    // Fixed-size buffers: a FIFO of about two encoder frames and one frame
+    // to hand to the encoder, reused for the whole file
+    session.frameSize = encoder->frame_size > 0 ? encoder->frame_size : 1024;
+    session.fifo = av_audio_fifo_alloc(encoder->sample_fmt, encoder->ch_layout.nb_channels,
+                                       session.frameSize * 2);
+    session.inputPacket = av_packet_alloc();
+    session.packet = av_packet_alloc();
+    session.decoded = av_frame_alloc();
+    session.encodeFrame = av_frame_alloc();
+    if (!session.fifo || !session.inputPacket || !session.packet || !session.decoded || !session.encodeFrame) {
+        job.error = "out of memory";
+        return false;
+    }
+
+    session.encodeFrame->nb_samples = session.frameSize;
+    session.encodeFrame->format = encoder->sample_fmt;
+    session.encodeFrame->sample_rate = encoder->sample_rate;
+    av_channel_layout_copy(&session.encodeFrame->ch_layout, &encoder->ch_layout);
+    if (av_frame_get_buffer(session.encodeFrame, 0) < 0) {
+        job.error = "out of memory";
+        return false;
+    }
+
+    AVPacket* packet = session.inputPacket;
+    double decodedSeconds = 0.0;
+    bool draining = false;
+    ret = 0;
+    while (ret >= 0) {
+        if (!draining) {
+            int readResult = av_read_frame(session.input.formatContext, packet);
+            if (readResult < 0) {
+                // Flush the decoder
+                draining = true;
+                avcodec_send_packet(decoder, nullptr);
+            } else if (packet->stream_index == session.input.streamIndex) {
+                // Corrupt packets are skipped, as in playback
+                avcodec_send_packet(decoder, packet);
+                av_packet_unref(packet);
+            } else {
+                av_packet_unref(packet);
+                continue;
+            }
+        }
+
+        int received;
+        while ((received = avcodec_receive_frame(decoder, session.decoded)) >= 0) {
+            decodedSeconds += (double)session.decoded->nb_samples / decoder->sample_rate;
+            ret = convertIntoFifo(session, session.decoded);
+            av_frame_unref(session.decoded);
+            if (ret >= 0) {
+                ret = drainFifo(session, false);
+            }
+            if (ret < 0) {
+                break;
+            }
+        }
+
+        job.audioSeconds.store(decodedSeconds);
+        if (session.input.duration > 0.0) {
+            job.progress.store(std::min(1.0, decodedSeconds / session.input.duration));
+        }
+
+        if (draining && received == AVERROR_EOF) {
+            break;
+        }
+    }
+    if (ret < 0) {
+        job.error = "encoding failed: " + errorString(ret);
+        return false;
+    }
+
+    // Drain swr, the FIFO and the encoder
+    ret = convertIntoFifo(session, nullptr);
+    if (ret >= 0) ret = drainFifo(session, true);
+    if (ret >= 0) ret = encodeAndWrite(session, nullptr);
+    if (ret >= 0) ret = av_write_trailer(session.output);
+    if (ret < 0) {
+        job.error = "finalizing output failed: " + errorString(ret);
+        return false;
+    }
+
+    job.progress.store(1.0);
+    return true;
+}
+
+void Transcoder::printProgress(double elapsedSeconds, bool final) const {
+    size_t done = 0, failed = 0;
+    double audioSeconds = 0.0;
+    for (const auto& job : m_jobs) {
+        JobState state = job->state.load();
+        if (state == JobState::DONE) done++;
+        if (state == JobState::FAILED) failed++;
+        audioSeconds += job->audioSeconds.load();
+    }
+
+    double speed = elapsedSeconds > 0.0 ? audioSeconds / elapsedSeconds : 0.0;
+    double filesPerSecond = elapsedSeconds > 0.0 ? (done + failed) / elapsedSeconds : 0.0;
+
+    std::cout << std::fixed << std::setprecision(1);
+    if (!final) {
+        for (const auto& job : m_jobs) {
+            if (job->state.load() == JobState::RUNNING) {
+                std::cout << "  " << std::setw(5) << job->progress.load() * 100.0 << "%  "
+                          << job->input << std::endl;
+            }
+        }
+    } else {
+        std::cout << "\n=== Transcode Summary ===" << std::endl;
+    }
+
+    std::cout << "[" << (done + failed) << "/" << m_jobs.size() << "] "
+              << done << " done, " << failed << " failed, "
+              << std::setprecision(2) << filesPerSecond << " files/s, "
+              << std::setprecision(1) << speed << "x realtime, "
+              << elapsedSeconds << "s elapsed" << std::endl;
+
+    if (final) {
+        std::cout << "=========================" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
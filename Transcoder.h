@@ -0,0 +1,74 @@
+#ifndef TRANSCODER_H
+#define TRANSCODER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// Headless batch converter. Files are decoded with the same demux/decode
+// path as the player, resampled with swr and re-encoded; a fixed pool of
+// workers (one per core by default) pulls files from a shared queue, and
+// each job streams frame by frame so its memory use does not depend on the
+// length of the file.
+class Transcoder {
+public:
+    struct Options {
+        std::string codec = "opus";   // opus, mp3, aac, flac, vorbis, wav or an encoder name
+        std::string format;           // output extension, selects the container (default per codec)
+        std::string outputDir = ".";
+        int64_t bitRate = 0;          // bits/s, 0 = encoder default
+        int sampleRate = 0;           // Hz, 0 = keep the source rate where supported
+        int jobs = 0;                 // 0 = one per hardware thread
+    };
+
+    enum class JobState {
+        PENDING,
+        RUNNING,
+        DONE,
+        FAILED
+    };
+
+    explicit Transcoder(const Options& options);
+
+    // Blocks until every input has been processed, printing per-job progress
+    // and aggregate throughput. Returns false if any job failed.
+    bool run(const std::vector<std::string>& inputs);
+
+private:
+    struct Job {
+        std::string input;
+        std::string output;
+        std::atomic<JobState> state{JobState::PENDING};
+        std::atomic<double> progress{0.0};      // 0.0 to 1.0
+        std::atomic<double> audioSeconds{0.0};  // decoded so far
+        std::string error;                      // valid once FAILED
+        bool createdOutput = false;             // this job opened (and truncated) output
+    };
+
+    bool resolveEncoder();
+    size_t rejectUnsafeOutputs();
+    void workerLoop();
+    bool transcodeFile(Job& job);
+    void printProgress(double elapsedSeconds, bool final) const;
+
+    Options m_options;
+    const AVCodec* m_encoder;
+    std::string m_extension;
+
+    std::vector<std::unique_ptr<Job>> m_jobs;
+    std::atomic<size_t> m_nextJob;
+    std::atomic<size_t> m_finishedJobs;
+
+    std::mutex m_doneMutex;
+    std::condition_variable m_doneCondition;
+};
+
+#endif // TRANSCODER_H
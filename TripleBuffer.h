@@ -0,0 +1,49 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Wait-free single-writer/single-reader hand-off of a value. The writer
+// fills writeBuffer() completely and publishes it; the reader picks up the
+// most recent published value with update(). Neither side ever blocks.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer()
+        : m_writeIndex(0)
+        , m_middle(1)
+        , m_readIndex(2)
+    {
+    }
+
+    // Writer side. The buffer holds stale data, so write every field.
+    T& writeBuffer() { return m_buffers[m_writeIndex]; }
+
+    void publish() {
+        int previous = m_middle.exchange(m_writeIndex | DIRTY, std::memory_order_acq_rel);
+        m_writeIndex = previous & INDEX_MASK;
+    }
+
+    // Reader side. Returns true if a newer value was picked up.
+    bool update() {
+        if (!(m_middle.load(std::memory_order_relaxed) & DIRTY)) {
+            return false;
+        }
+        int previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = previous & INDEX_MASK;
+        return true;
+    }
+
+    const T& readBuffer() const { return m_buffers[m_readIndex]; }
+
+private:
+    static constexpr int INDEX_MASK = 0x3;
+    static constexpr int DIRTY = 0x4;
+
+    T m_buffers[3];
+    int m_writeIndex;
+    std::atomic<int> m_middle;
+    int m_readIndex;
+};
+
+#endif // TRIPLEBUFFER_H
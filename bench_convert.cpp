@@ -0,0 +1,192 @@
+#include "Bench.h"
+#include "SampleConvert.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+// Checks every SampleConvert kernel against swr_convert on the same input,
+// then times both. swr gets the same configuration setupAudioConversion
+// would give it: no rate change, S16 interleaved output.
+
+namespace {
+
+constexpr int kRate = 48000;
+constexpr int kBlockFrames = 1024;     // a typical decoded frame
+constexpr int kCheckFrames = 48000;
+
+struct Case {
+    const char* name;
+    AVSampleFormat format;
+    int inChannels;
+    int outChannels;
+};
+
+const Case kCases[] = {
+    {"fltp 2 -> s16 2", AV_SAMPLE_FMT_FLTP, 2, 2},
+    {"flt  2 -> s16 2", AV_SAMPLE_FMT_FLT, 2, 2},
+    {"s16p 2 -> s16 2", AV_SAMPLE_FMT_S16P, 2, 2},
+    {"fltp 6 -> s16 6", AV_SAMPLE_FMT_FLTP, 6, 6},
+    {"s16p 6 -> s16 6", AV_SAMPLE_FMT_S16P, 6, 6},
+    {"fltp 8 -> s16 8", AV_SAMPLE_FMT_FLTP, 8, 8},
+    {"s16p 8 -> s16 8", AV_SAMPLE_FMT_S16P, 8, 8},
+    {"fltp 1 -> s16 2", AV_SAMPLE_FMT_FLTP, 1, 2},
+    {"flt  1 -> s16 2", AV_SAMPLE_FMT_FLT, 1, 2},
+    {"s16  1 -> s16 2", AV_SAMPLE_FMT_S16, 1, 2},
+};
+
+// Decoder-shaped input: one buffer per plane, or one interleaved buffer
+class Input {
+public:
+    Input(AVSampleFormat format, int channels, int frames, std::mt19937& random)
+        : m_planar(av_sample_fmt_is_planar(format) != 0)
+    {
+        const int planes = m_planar ? channels : 1;
+        const int samplesPerPlane = m_planar ? frames : frames * channels;
+        const bool isFloat = format == AV_SAMPLE_FMT_FLT || format == AV_SAMPLE_FMT_FLTP;
+        const int bytes = isFloat ? 4 : 2;
+
+        // Mostly in range, with overs on both sides to exercise saturation
+        // and the exact full-scale edges
+        std::uniform_real_distribution<float> level(-1.25f, 1.25f);
+        std::uniform_int_distribution<int> sample(-32768, 32767);
+        static const float kEdges[] = {1.0f, -1.0f, 32767.0f / 32768.0f, -32768.5f / 32768.0f,
+                                       0.5f / 32768.0f, 1.5f / 32768.0f, -0.5f / 32768.0f};
+
+        m_buffers.resize(planes);
+        for (int p = 0; p < planes; p++) {
+            m_buffers[p].resize(static_cast<size_t>(samplesPerPlane) * bytes);
+            for (int i = 0; i < samplesPerPlane; i++) {
+                uint8_t* dst = m_buffers[p].data() + static_cast<size_t>(i) * bytes;
+                if (isFloat) {
+                    float v = i < 7 ? kEdges[i] : level(random);
+                    std::memcpy(dst, &v, sizeof(v));
+                } else {
+                    int16_t v = static_cast<int16_t>(sample(random));
+                    std::memcpy(dst, &v, sizeof(v));
+                }
+            }
+        }
+        m_bytesPerFrame = m_planar ? bytes : bytes * channels;
+    }
+
+    // Plane pointers starting at `frame`
+    const uint8_t* const* at(int frame) {
+        m_pointers.resize(m_buffers.size());
+        for (size_t p = 0; p < m_buffers.size(); p++) {
+            m_pointers[p] = m_buffers[p].data() + static_cast<size_t>(frame) * m_bytesPerFrame;
+        }
+        return m_pointers.data();
+    }
+
+private:
+    bool m_planar;
+    int m_bytesPerFrame;
+    std::vector<std::vector<uint8_t>> m_buffers;
+    std::vector<const uint8_t*> m_pointers;
+};
+
+SwrContext* createSwr(const Case& c) {
+    AVChannelLayout in;
+    AVChannelLayout out;
+    av_channel_layout_default(&in, c.inChannels);
+    av_channel_layout_default(&out, c.outChannels);
+
+    SwrContext* swr = nullptr;
+    if (swr_alloc_set_opts2(&swr, &out, AV_SAMPLE_FMT_S16, kRate, &in, c.format, kRate, 0, nullptr) < 0 ||
+        swr_init(swr) < 0) {
+        swr_free(&swr);
+    }
+    av_channel_layout_uninit(&in);
+    av_channel_layout_uninit(&out);
+    return swr;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(1);
+    bool passed = true;
+
+    std::cout << std::left << std::setw(18) << "case" << std::right
+              << std::setw(10) << "exact %" << std::setw(9) << "max err"
+              << std::setw(13) << "swr Ms/s" << std::setw(13) << "kernel Ms/s"
+              << std::setw(9) << "speedup" << std::endl;
+    Bench::printRule(72);
+
+    for (const Case& c : kCases) {
+        SampleConvert::Kernel kernel = SampleConvert::findKernel(c.format, c.inChannels, c.outChannels);
+        SwrContext* swr = createSwr(c);
+        if (!kernel || !swr) {
+            std::cout << std::left << std::setw(18) << c.name << "  missing "
+                      << (kernel ? "swr context" : "kernel") << std::endl;
+            swr_free(&swr);
+            passed = false;
+            continue;
+        }
+
+        Input input(c.format, c.inChannels, kCheckFrames, random);
+        const size_t outSamples = static_cast<size_t>(kCheckFrames) * c.outChannels;
+        std::vector<int16_t> expected(outSamples);
+        std::vector<int16_t> actual(outSamples);
+
+        // Correctness over the whole buffer, one decoder-sized block at a time
+        for (int frame = 0; frame < kCheckFrames; frame += kBlockFrames) {
+            int frames = std::min(kBlockFrames, kCheckFrames - frame);
+            uint8_t* out[] = {reinterpret_cast<uint8_t*>(expected.data() + static_cast<size_t>(frame) * c.outChannels)};
+            int converted = swr_convert(swr, out, frames, const_cast<const uint8_t**>(input.at(frame)), frames);
+            if (converted != frames) {
+                std::cout << c.name << ": swr returned " << converted << " of " << frames << " frames" << std::endl;
+                passed = false;
+            }
+            kernel(input.at(frame), actual.data() + static_cast<size_t>(frame) * c.outChannels, frames);
+        }
+
+        size_t exact = 0;
+        int maxError = 0;
+        for (size_t i = 0; i < outSamples; i++) {
+            int error = std::abs(expected[i] - actual[i]);
+            exact += error == 0;
+            maxError = std::max(maxError, error);
+        }
+
+        // Throughput on one block that stays in cache
+        std::vector<int16_t> block(static_cast<size_t>(kBlockFrames) * c.outChannels);
+        const uint8_t* const* in = input.at(0);
+        double swrSeconds = Bench::secondsPerCall([&] {
+            uint8_t* out[] = {reinterpret_cast<uint8_t*>(block.data())};
+            Bench::keep(swr_convert(swr, out, kBlockFrames, const_cast<const uint8_t**>(in), kBlockFrames));
+        });
+        double kernelSeconds = Bench::secondsPerCall([&] {
+            kernel(in, block.data(), kBlockFrames);
+            Bench::keep(block[0]);
+        });
+
+        const double samples = static_cast<double>(kBlockFrames) * c.outChannels;
+        std::cout << std::left << std::setw(18) << c.name << std::right << std::fixed
+                  << std::setw(10) << std::setprecision(3) << 100.0 * exact / outSamples
+                  << std::setw(9) << maxError
+                  << std::setw(13) << std::setprecision(0) << samples / swrSeconds / 1e6
+                  << std::setw(13) << samples / kernelSeconds / 1e6
+                  << std::setw(8) << std::setprecision(1) << swrSeconds / kernelSeconds << "x" << std::endl;
+
+        // swr's own SIMD paths may round a half-LSB tie differently; anything
+        // beyond one LSB is a real bug
+        if (maxError > 1) {
+            passed = false;
+        }
+        swr_free(&swr);
+    }
+
+    std::cout << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+#include "Bench.h"
+#include "DspChain.h"
+#include "ParametricEq.h"
+#include "SampleConvert.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Cost of the parametric EQ per stream as the band count grows, measured
+// the way MusicPlayer::processDsp runs it: S16 block -> float -> chain ->
+// S16, one decoded frame at a time.
+
+namespace {
+
+constexpr int kRate = 48000;
+constexpr int kBlockFrames = 1024;
+
+const int kChannelCounts[] = {2, 6};
+const int kBandCounts[] = {0, 1, 2, 4, 8, 16};
+
+} // namespace
+
+int main() {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> noise(-16384, 16383);
+
+    std::cout << std::setw(4) << "ch" << std::setw(7) << "bands" << std::setw(12) << "us/block"
+              << std::setw(12) << "ns/frame" << std::setw(14) << "x realtime"
+              << std::setw(12) << "% of core" << std::endl;
+    Bench::printRule(61);
+
+    for (int channels : kChannelCounts) {
+        const size_t samples = static_cast<size_t>(kBlockFrames) * channels;
+        std::vector<int16_t> input(samples);
+        for (auto& s : input) {
+            s = static_cast<int16_t>(noise(random));
+        }
+        std::vector<int16_t> pcm(samples);
+        std::vector<float> buffer(samples);
+
+        for (int bands : kBandCounts) {
+            auto eq = std::make_shared<ParametricEq>();
+            for (int b = 0; b < bands; b++) {
+                // Spread over the audible range with alternating boost/cut
+                ParametricEq::Band band;
+                band.enabled = true;
+                band.frequency = 40.0f * std::pow(400.0f, static_cast<float>(b) / ParametricEq::MAX_BANDS);
+                band.gainDb = b % 2 == 0 ? 3.0f : -3.0f;
+                band.q = 1.0f;
+                eq->setBand(b, band);
+            }
+
+            DspChain chain;
+            chain.prepare(kRate, channels);
+            chain.addProcessor(eq);
+
+            double seconds = Bench::secondsPerCall([&] {
+                std::copy(input.begin(), input.end(), pcm.begin());
+                SampleConvert::toFloat(pcm.data(), buffer.data(), static_cast<int>(samples));
+                chain.process(buffer.data(), kBlockFrames);
+                SampleConvert::toS16(buffer.data(), pcm.data(), static_cast<int>(samples));
+                Bench::keep(pcm[0]);
+            });
+
+            const double audioSeconds = static_cast<double>(kBlockFrames) / kRate;
+            std::cout << std::fixed << std::setw(4) << channels << std::setw(7) << bands
+                      << std::setw(12) << std::setprecision(2) << seconds * 1e6
+                      << std::setw(12) << std::setprecision(1) << seconds * 1e9 / kBlockFrames
+                      << std::setw(14) << std::setprecision(0) << audioSeconds / seconds
+                      << std::setw(12) << std::setprecision(3) << 100.0 * seconds / audioSeconds
+                      << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "Bench.h"
+#include "Fingerprinter.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+// Fingerprints synthetic tracks and copies of them that start at another
+// sample offset, with a gain change and noise at about -20 dB standing in
+// for a poor re-encode. Every copy must be matched to its original, including those
+// misaligned by half a hop, and no two originals may be matched.
+
+namespace {
+
+constexpr int kRate = Fingerprinter::SAMPLE_RATE;
+constexpr int kTracks = 32;
+constexpr int kTrackSeconds = 45;
+
+struct Shift {
+    const char* name;
+    int samples;
+};
+
+const Shift kShifts[] = {
+    {"aligned", 0},
+    {"half hop", Fingerprinter::HOP_SIZE / 2},
+    {"1 s + half hop", kRate + Fingerprinter::HOP_SIZE / 2},
+    {"odd", 1237},
+};
+
+// Decaying harmonic notes of random pitch and length over a noise floor,
+// with a noise burst on every beat
+std::vector<float> makeTrack(std::mt19937& random) {
+    std::uniform_real_distribution<float> pitch(110.0f, 880.0f);
+    std::uniform_real_distribution<float> length(0.15f, 0.6f);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+
+    std::vector<float> pcm(static_cast<size_t>(kTrackSeconds) * kRate);
+    size_t position = 0;
+    while (position < pcm.size()) {
+        const size_t noteSamples = static_cast<size_t>(length(random) * kRate);
+        const float frequency = pitch(random);
+        for (size_t i = 0; i < noteSamples && position + i < pcm.size(); i++) {
+            const float t = static_cast<float>(i) / kRate;
+            float value = 0.0f;
+            for (int h = 1; h <= 4; h++) {
+                value += std::sin(2.0f * static_cast<float>(M_PI) * frequency * h * t) / h;
+            }
+            pcm[position + i] = 0.25f * value * std::exp(-3.0f * t);
+        }
+        position += noteSamples;
+    }
+    const size_t beat = kRate / 2;
+    for (size_t start = 0; start < pcm.size(); start += beat) {
+        for (size_t i = 0; i < beat / 8 && start + i < pcm.size(); i++) {
+            pcm[start + i] += 0.1f * noise(random) * std::exp(-40.0f * i / kRate);
+        }
+    }
+    for (auto& sample : pcm) {
+        sample += 0.002f * noise(random);
+    }
+    return pcm;
+}
+
+// `original` from `shift` samples in, quieter and with its own noise
+std::vector<float> makeCopy(const std::vector<float>& original, int shift, std::mt19937& random) {
+    std::normal_distribution<float> noise(0.0f, 0.02f);
+    std::vector<float> copy(original.begin() + shift, original.end());
+    for (auto& sample : copy) {
+        sample = 0.7f * sample + noise(random);
+    }
+    return copy;
+}
+
+Fingerprinter::Fingerprint fingerprintOf(const std::vector<float>& pcm) {
+    Fingerprinter::Fingerprint fingerprint;
+    Fingerprinter::computeWords(pcm.data(), pcm.size(), fingerprint);
+    fingerprint.duration = static_cast<float>(pcm.size()) / kRate;
+    return fingerprint;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(1);
+    bool passed = true;
+
+    std::vector<std::vector<float>> tracks;
+    for (int t = 0; t < kTracks; t++) {
+        tracks.push_back(makeTrack(random));
+    }
+
+    // Originals first, then one copy of every track per shift
+    std::vector<Fingerprinter::Fingerprint> fingerprints;
+    auto start = Bench::Clock::now();
+    for (const auto& track : tracks) {
+        fingerprints.push_back(fingerprintOf(track));
+    }
+    const double computeSeconds = Bench::secondsSince(start) / kTracks;
+    for (const Shift& shift : kShifts) {
+        for (const auto& track : tracks) {
+            fingerprints.push_back(fingerprintOf(makeCopy(track, shift.samples, random)));
+        }
+    }
+
+    std::vector<const Fingerprinter::Fingerprint*> pointers;
+    for (const auto& fingerprint : fingerprints) {
+        pointers.push_back(&fingerprint);
+    }
+    std::vector<Fingerprinter::Match> matches;
+    const double matchSeconds = Bench::secondsPerCall([&] {
+        matches = Fingerprinter::findDuplicates(pointers, Fingerprinter::Options().maxBitErrorRate);
+        Bench::keep(static_cast<int64_t>(matches.size()));
+    });
+
+    // Track of each fingerprint; a match is right when both sides agree
+    std::set<std::pair<uint32_t, uint32_t>> found;
+    int wrong = 0;
+    for (const auto& match : matches) {
+        if (match.a % kTracks != match.b % kTracks) {
+            wrong++;
+        }
+        found.insert({std::min(match.a, match.b), std::max(match.a, match.b)});
+    }
+
+    std::cout << std::left << std::setw(16) << "copy" << std::right << std::setw(10) << "matched"
+              << std::setw(10) << "worst BER" << std::endl;
+    Bench::printRule(36);
+    for (size_t s = 0; s < sizeof(kShifts) / sizeof(kShifts[0]); s++) {
+        int matched = 0;
+        float worst = 0.0f;
+        for (uint32_t t = 0; t < kTracks; t++) {
+            const uint32_t copy = static_cast<uint32_t>((s + 1) * kTracks) + t;
+            if (found.count({t, copy})) {
+                matched++;
+            }
+            float best = 1.0f;
+            for (int delta = -1; delta <= 1; delta++) {
+                int overlap = 0;
+                const int offset = kShifts[s].samples / Fingerprinter::HOP_SIZE + delta;
+                best = std::min(best, Fingerprinter::bitErrorRate(fingerprints[t], fingerprints[copy], offset, overlap));
+            }
+            worst = std::max(worst, best);
+        }
+        std::cout << std::left << std::setw(16) << kShifts[s].name << std::right << std::setw(7) << matched
+                  << "/" << std::setw(2) << kTracks << std::fixed << std::setprecision(3)
+                  << std::setw(10) << worst << std::endl;
+        if (matched != kTracks) {
+            passed = false;
+        }
+    }
+
+    std::cout << std::endl << "wrong matches: " << wrong << std::endl;
+    std::cout << std::fixed << std::setprecision(1) << "fingerprint:   " << computeSeconds * 1e3
+              << " ms per " << kTrackSeconds << " s track" << std::endl;
+    std::cout << "match:         " << matchSeconds * 1e3 << " ms for " << fingerprints.size()
+              << " fingerprints" << std::endl;
+    if (wrong != 0) {
+        passed = false;
+    }
+
+    std::cout << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+#include "Bench.h"
+#include "LibraryIndex.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Builds synthetic libraries of 10k, 100k and 1M tracks with
+// LibraryBuilder::add, then times the snapshot round trip and every query
+// the `library` command exposes. Query results are checked against a
+// linear scan of the generated tracks.
+
+namespace {
+
+const size_t kLibrarySizes[] = {10000, 100000, 1000000};
+constexpr int kTracksPerAlbum = 12;
+constexpr int kAlbumsPerArtist = 4;
+constexpr int kQueryVariants = 64;
+
+const char* kSyllables[] = {
+    "ka", "lo", "mi", "ren", "sa", "tor", "vel", "an", "dra", "fi", "gun", "hel",
+    "is", "jo", "ku", "mar", "ne", "os", "pra", "qui", "ra", "sel", "ti", "um",
+};
+constexpr int kSyllableCount = sizeof(kSyllables) / sizeof(kSyllables[0]);
+
+// Capitalized pseudo-word, deterministic in `id`
+std::string word(uint32_t id, int syllables) {
+    std::string text;
+    for (int i = 0; i < syllables; i++) {
+        text += kSyllables[id % kSyllableCount];
+        id = id / kSyllableCount + id * 7 + 3;
+    }
+    text[0] = static_cast<char>(text[0] - ('a' - 'A'));
+    return text;
+}
+
+std::vector<TrackInfo> makeTracks(size_t count, std::mt19937& random) {
+    std::uniform_int_distribution<uint32_t> anyWord(0, 1u << 20);
+    std::uniform_real_distribution<float> duration(90.0f, 420.0f);
+    std::uniform_real_distribution<float> weight(0.25f, 4.0f);
+
+    std::vector<TrackInfo> tracks(count);
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t album = static_cast<uint32_t>(i / kTracksPerAlbum);
+        const uint32_t artist = album / kAlbumsPerArtist;
+        TrackInfo& track = tracks[i];
+        track.artist = word(artist, 2) + " " + word(artist + 977, 3);
+        track.album = word(album + 31, 3) + " " + word(album + 57, 2);
+        track.title = word(anyWord(random), 2 + static_cast<int>(i % 3)) + " " + word(anyWord(random), 2);
+        track.path = "/music/" + track.artist + "/" + track.album + "/" + std::to_string(i) + ".flac";
+        track.genre = word(artist % 40, 2);
+        track.codec = "flac";
+        track.trackNumber = static_cast<uint32_t>(i % kTracksPerAlbum) + 1;
+        track.duration = duration(random);
+        track.sampleRate = 44100;
+        track.weight = weight(random);
+    }
+    return tracks;
+}
+
+std::string fold(std::string_view text) {
+    std::string folded(text);
+    for (auto& c : folded) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c + ('a' - 'A'));
+    }
+    return folded;
+}
+
+size_t countMatches(const std::vector<TrackInfo>& tracks, std::string_view text) {
+    const std::string needle = fold(text);
+    size_t matches = 0;
+    for (const auto& track : tracks) {
+        matches += fold(track.title).find(needle) != std::string::npos ||
+                   fold(track.artist).find(needle) != std::string::npos ||
+                   fold(track.album).find(needle) != std::string::npos;
+    }
+    return matches;
+}
+
+void printRow(const char* operation, double seconds, size_t results) {
+    std::cout << std::left << std::setw(24) << operation << std::right << std::fixed;
+    if (seconds >= 1e-3) {
+        std::cout << std::setw(12) << std::setprecision(2) << seconds * 1e3 << " ms";
+    } else {
+        std::cout << std::setw(12) << std::setprecision(2) << seconds * 1e6 << " us";
+    }
+    std::cout << std::setw(12) << results << std::endl;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(1);
+    bool passed = true;
+    const std::string snapshotFile =
+        (std::filesystem::temp_directory_path() / "bench_library.snapshot").string();
+
+    for (size_t size : kLibrarySizes) {
+        std::vector<TrackInfo> tracks = makeTracks(size, random);
+
+        auto start = Bench::Clock::now();
+        LibraryBuilder builder;
+        for (const auto& track : tracks) {
+            builder.add(track);
+        }
+        LibraryIndex index;
+        index.adopt(builder.build());
+        const double buildSeconds = Bench::secondsSince(start);
+
+        start = Bench::Clock::now();
+        bool saved = index.save(snapshotFile);
+        const double saveSeconds = Bench::secondsSince(start);
+        const auto snapshotBytes = saved ? std::filesystem::file_size(snapshotFile) : 0;
+
+        LibraryIndex loaded;
+        start = Bench::Clock::now();
+        bool reloaded = saved && loaded.load(snapshotFile);
+        const double loadSeconds = Bench::secondsSince(start);
+        std::remove(snapshotFile.c_str());
+        if (!reloaded || loaded.size() != size) {
+            std::cout << size << " tracks: snapshot round trip failed" << std::endl;
+            passed = false;
+            continue;
+        }
+
+        std::cout << std::endl << size << " tracks, snapshot " << std::fixed << std::setprecision(1)
+                  << snapshotBytes / 1048576.0 << " MB" << std::endl;
+        std::cout << std::left << std::setw(24) << "operation" << std::right
+                  << std::setw(15) << "time" << std::setw(12) << "results" << std::endl;
+        Bench::printRule(51);
+        printRow("build", buildSeconds, size);
+        printRow("save", saveSeconds, size);
+        printRow("load", loadSeconds, size);
+
+        // Rotate through several keys so one hot cache line does not flatter
+        // the lookups
+        std::vector<std::string> artists;
+        std::vector<std::string> prefixes;
+        for (int i = 0; i < kQueryVariants; i++) {
+            const TrackInfo& track = tracks[(i * 7919u) % size];
+            artists.push_back(fold(track.artist));
+            prefixes.push_back(track.title.substr(0, 4));
+        }
+        const std::string rareText = fold(tracks[size / 2].album);
+        const std::string commonText = "ren";
+        const std::string shortText = "ka";
+
+        size_t artistHits = 0;
+        size_t next = 0;
+        double seconds = Bench::secondsPerCall([&] {
+            auto result = index.findByArtist(artists[next++ % kQueryVariants]);
+            artistHits = result.size();
+            Bench::keep(static_cast<int64_t>(result.size()));
+        });
+        printRow("artist (exact)", seconds, artistHits);
+        const size_t artistTracks = std::count_if(tracks.begin(), tracks.end(), [&](const TrackInfo& track) {
+            return track.artist == tracks[0].artist;
+        });
+        if (index.findByArtist(tracks[0].artist).size() != artistTracks) {
+            std::cout << "  artist results do not match a linear scan" << std::endl;
+            passed = false;
+        }
+
+        size_t prefixHits = 0;
+        seconds = Bench::secondsPerCall([&] {
+            auto result = index.findByTitlePrefix(prefixes[next++ % kQueryVariants]);
+            prefixHits = result.size();
+            Bench::keep(static_cast<int64_t>(result.size()));
+        });
+        printRow("title prefix (4 chars)", seconds, prefixHits);
+
+        struct SearchCase { const char* name; const std::string* text; };
+        const SearchCase searches[] = {
+            {"search (album name)", &rareText},
+            {"search (common 3)", &commonText},
+            {"search (2 chars, scan)", &shortText},
+        };
+        for (const auto& search : searches) {
+            size_t hits = 0;
+            seconds = Bench::secondsPerCall([&] {
+                auto result = index.search(*search.text);
+                hits = result.size();
+                Bench::keep(static_cast<int64_t>(result.size()));
+            });
+            printRow(search.name, seconds, hits);
+            if (hits != countMatches(tracks, *search.text)) {
+                std::cout << "  search results do not match a linear scan" << std::endl;
+                passed = false;
+            }
+        }
+
+        seconds = Bench::secondsPerCall([&] {
+            Bench::keep(index.sortedByAlbum()[0]);
+        });
+        printRow("sorted by album", seconds, size);
+
+        uint64_t seed = 1;
+        seconds = Bench::secondsPerCall([&] {
+            Bench::keep(index.shuffle(seed++, 100)[0]);
+        });
+        printRow("shuffle (100 of all)", seconds, 100);
+    }
+
+    std::cout << std::endl << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed ? 0 : 1;
+}
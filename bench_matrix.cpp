@@ -0,0 +1,175 @@
+#include "Bench.h"
+#include "ChannelMatrix.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+// ChannelMatrix against swr for the downmixes players actually hit. With
+// default gains every coefficient must equal the one swr_build_matrix2
+// produces (as the float swr mixes with), bit for bit; then both remix
+// the same float planes to S16 and are timed on a decoder-sized block.
+
+namespace {
+
+constexpr int kRate = 48000;
+constexpr int kBlockFrames = 1024;
+constexpr int kCheckFrames = 48000;
+
+struct Case {
+    const char* name;
+    uint64_t in;
+    uint64_t out;
+};
+
+const Case kCases[] = {
+    {"5.1      -> stereo", AV_CH_LAYOUT_5POINT1, AV_CH_LAYOUT_STEREO},
+    {"5.1(back)-> stereo", AV_CH_LAYOUT_5POINT1_BACK, AV_CH_LAYOUT_STEREO},
+    {"7.1      -> stereo", AV_CH_LAYOUT_7POINT1, AV_CH_LAYOUT_STEREO},
+    {"5.1      -> mono", AV_CH_LAYOUT_5POINT1, AV_CH_LAYOUT_MONO},
+    {"5.1(back)-> mono", AV_CH_LAYOUT_5POINT1_BACK, AV_CH_LAYOUT_MONO},
+    {"7.1      -> mono", AV_CH_LAYOUT_7POINT1, AV_CH_LAYOUT_MONO},
+    {"stereo   -> mono", AV_CH_LAYOUT_STEREO, AV_CH_LAYOUT_MONO},
+};
+
+// swr's defaults for float input and S16 output: -3 dB center and
+// surround, LFE dropped, normalized to a peak of 1.0
+constexpr double kSwrMixLevel = M_SQRT1_2;
+
+// swr_build_matrix2 normalizes a full 64 x 64 block at the given stride,
+// so the buffer has to be that size, as swr's own is
+constexpr int kSwrMaxChannels = 64;
+
+// Coefficients that differ from swr's
+int compareCoefficients(const ChannelMatrix& matrix, const AVChannelLayout& in, const AVChannelLayout& out) {
+    std::vector<double> expected(static_cast<size_t>(kSwrMaxChannels) * kSwrMaxChannels, 0.0);
+    if (swr_build_matrix2(&in, &out, kSwrMixLevel, kSwrMixLevel, 0.0, 1.0, 1.0, expected.data(),
+                          kSwrMaxChannels, AV_MATRIX_ENCODING_NONE, nullptr) < 0) {
+        return out.nb_channels * in.nb_channels;
+    }
+
+    int mismatches = 0;
+    for (int o = 0; o < out.nb_channels; o++) {
+        for (int i = 0; i < in.nb_channels; i++) {
+            float swr = static_cast<float>(expected[static_cast<size_t>(o) * kSwrMaxChannels + i]);
+            float ours = matrix.coefficient(o, i);
+            if (swr != ours) {
+                std::cout << "  out " << o << " in " << i << ": swr " << std::setprecision(9) << swr
+                          << ", matrix " << ours << std::endl;
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+SwrContext* createSwr(const AVChannelLayout& in, const AVChannelLayout& out) {
+    SwrContext* swr = nullptr;
+    if (swr_alloc_set_opts2(&swr, &out, AV_SAMPLE_FMT_S16, kRate, &in, AV_SAMPLE_FMT_FLTP, kRate, 0, nullptr) < 0 ||
+        swr_init(swr) < 0) {
+        swr_free(&swr);
+    }
+    return swr;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> level(-1.0f, 1.0f);
+    bool passed = true;
+
+    std::cout << std::left << std::setw(20) << "case" << std::right << std::setw(8) << "coeffs"
+              << std::setw(9) << "max err" << std::setw(13) << "swr Mf/s" << std::setw(14) << "matrix Mf/s"
+              << std::setw(9) << "speedup" << std::endl;
+    Bench::printRule(73);
+
+    for (const Case& c : kCases) {
+        AVChannelLayout in;
+        AVChannelLayout out;
+        av_channel_layout_from_mask(&in, c.in);
+        av_channel_layout_from_mask(&out, c.out);
+
+        ChannelMatrix matrix;
+        SwrContext* swr = createSwr(in, out);
+        if (!matrix.build(in, out, ChannelMatrix::Gains()) || !swr) {
+            std::cout << std::left << std::setw(20) << c.name << "  setup failed" << std::endl;
+            swr_free(&swr);
+            passed = false;
+            continue;
+        }
+
+        const int mismatches = compareCoefficients(matrix, in, out);
+
+        // Same planes through both, one decoder-sized block at a time
+        std::vector<std::vector<float>> planes(in.nb_channels, std::vector<float>(kCheckFrames));
+        for (auto& plane : planes) {
+            for (auto& sample : plane) {
+                sample = level(random);
+            }
+        }
+        const size_t outSamples = static_cast<size_t>(kCheckFrames) * out.nb_channels;
+        std::vector<int16_t> expected(outSamples);
+        std::vector<int16_t> actual(outSamples);
+        std::vector<const float*> pointers(in.nb_channels);
+        auto at = [&](int frame) {
+            for (int p = 0; p < in.nb_channels; p++) {
+                pointers[p] = planes[p].data() + frame;
+            }
+            return pointers.data();
+        };
+
+        for (int frame = 0; frame < kCheckFrames; frame += kBlockFrames) {
+            int frames = std::min(kBlockFrames, kCheckFrames - frame);
+            int16_t* swrOut = expected.data() + static_cast<size_t>(frame) * out.nb_channels;
+            uint8_t* outPlanes[] = {reinterpret_cast<uint8_t*>(swrOut)};
+            if (swr_convert(swr, outPlanes, frames, reinterpret_cast<const uint8_t**>(at(frame)), frames) != frames) {
+                passed = false;
+            }
+            matrix.process(at(frame), actual.data() + static_cast<size_t>(frame) * out.nb_channels, frames);
+        }
+        int maxError = 0;
+        for (size_t i = 0; i < outSamples; i++) {
+            maxError = std::max(maxError, std::abs(expected[i] - actual[i]));
+        }
+
+        std::vector<int16_t> block(static_cast<size_t>(kBlockFrames) * out.nb_channels);
+        const float* const* input = at(0);
+        double swrSeconds = Bench::secondsPerCall([&] {
+            uint8_t* outPlanes[] = {reinterpret_cast<uint8_t*>(block.data())};
+            Bench::keep(swr_convert(swr, outPlanes, kBlockFrames,
+                                    reinterpret_cast<const uint8_t**>(const_cast<const float**>(input)),
+                                    kBlockFrames));
+        });
+        double matrixSeconds = Bench::secondsPerCall([&] {
+            matrix.process(input, block.data(), kBlockFrames);
+            Bench::keep(block[0]);
+        });
+
+        std::cout << std::left << std::setw(20) << c.name << std::right << std::fixed
+                  << std::setw(8) << (mismatches == 0 ? "exact" : "DIFFER") << std::setw(9) << maxError
+                  << std::setw(13) << std::setprecision(0) << kBlockFrames / swrSeconds / 1e6
+                  << std::setw(14) << kBlockFrames / matrixSeconds / 1e6
+                  << std::setw(8) << std::setprecision(1) << swrSeconds / matrixSeconds << "x" << std::endl;
+
+        // Same coefficients, but swr may sum in another order and round a
+        // half-LSB tie differently; more than one LSB is a real difference
+        if (mismatches != 0 || maxError > 1) {
+            passed = false;
+        }
+        swr_free(&swr);
+        av_channel_layout_uninit(&in);
+        av_channel_layout_uninit(&out);
+    }
+
+    std::cout << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed ? 0 : 1;
+}
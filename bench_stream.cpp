@@ -0,0 +1,202 @@
+#include "Bench.h"
+#include "StreamServer.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Loopback load test for StreamServer: a producer pushes a tone in real
+// time the way the decoding thread would, while N clients connect over
+// 127.0.0.1 and read the stream. Every client must receive what the encoder
+// produced during the measurement window.
+//
+//   bench_stream [pcm|mp3|opus]   (default pcm, the most bytes per client)
+
+namespace {
+
+constexpr int kPort = 18000;
+constexpr int kRate = 44100;
+constexpr int kBlockFrames = 1024;
+const auto kWarmup = std::chrono::seconds(1);
+const auto kWindow = std::chrono::seconds(3);
+const int kClientCounts[] = {1, 16, 128, 500};
+
+// Share of the encoded bytes every client must receive in the window
+constexpr double kMinDelivered = 0.9;
+
+int connectClient() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(kPort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    static const char kRequest[] = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        send(fd, kRequest, sizeof(kRequest) - 1, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(kRequest) - 1) ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+struct Result {
+    int connected = 0;
+    int disconnected = 0;
+    double minShare = 0.0;
+    double meanShare = 0.0;
+    double megabitsPerSecond = 0.0;
+    double maxPushMicros = 0.0;
+    StreamServer::Stats before{};
+    StreamServer::Stats after{};
+};
+
+Result runLoad(StreamServer& server, int clientCount) {
+    Result result;
+    std::atomic<bool> producing{true};
+    double maxPushSeconds = 0.0;
+
+    // Real-time producer, shaped like MusicPlayer's decoding thread
+    std::thread producer([&] {
+        std::vector<int16_t> block(static_cast<size_t>(kBlockFrames) * 2);
+        const auto blockDuration = std::chrono::duration_cast<Bench::Clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(kBlockFrames) / kRate));
+        auto due = Bench::Clock::now();
+        uint64_t frame = 0;
+        while (producing.load()) {
+            for (int i = 0; i < kBlockFrames; i++, frame++) {
+                auto sample = static_cast<int16_t>(8000.0 * std::sin(2.0 * M_PI * 440.0 * frame / kRate));
+                block[2 * i] = block[2 * i + 1] = sample;
+            }
+            auto start = Bench::Clock::now();
+            server.push(block.data(), kBlockFrames, 2);
+            maxPushSeconds = std::max(maxPushSeconds, Bench::secondsSince(start));
+            due += blockDuration;
+            std::this_thread::sleep_until(due);
+        }
+    });
+
+    std::vector<int> fds;
+    for (int i = 0; i < clientCount; i++) {
+        int fd = connectClient();
+        if (fd >= 0) {
+            fds.push_back(fd);
+        }
+    }
+    result.connected = static_cast<int>(fds.size());
+
+    std::vector<uint64_t> received(fds.size(), 0);
+    std::vector<bool> open(fds.size(), true);
+    std::vector<pollfd> polls(fds.size());
+    char buffer[65536];
+
+    auto drain = [&](Bench::Clock::time_point until, bool count) {
+        while (Bench::Clock::now() < until) {
+            for (size_t i = 0; i < fds.size(); i++) {
+                polls[i] = { open[i] ? fds[i] : -1, POLLIN, 0 };
+            }
+            if (poll(polls.data(), polls.size(), 20) <= 0) {
+                continue;
+            }
+            for (size_t i = 0; i < fds.size(); i++) {
+                if (!(polls[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                    continue;
+                }
+                ssize_t bytes;
+                while ((bytes = recv(fds[i], buffer, sizeof(buffer), 0)) > 0) {
+                    if (count) received[i] += static_cast<uint64_t>(bytes);
+                }
+                if (bytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    open[i] = false;
+                    result.disconnected++;
+                }
+            }
+        }
+    };
+
+    // Past the headers and preroll burst, then the measured window
+    drain(Bench::Clock::now() + kWarmup, false);
+    result.before = server.getStats();
+    auto windowStart = Bench::Clock::now();
+    drain(windowStart + kWindow, true);
+    const double seconds = Bench::secondsSince(windowStart);
+    result.after = server.getStats();
+
+    producing.store(false);
+    producer.join();
+    for (int fd : fds) {
+        close(fd);
+    }
+
+    const double encoded = static_cast<double>(result.after.bytesEncoded - result.before.bytesEncoded);
+    uint64_t total = 0;
+    result.minShare = fds.empty() ? 0.0 : 1e9;
+    for (uint64_t bytes : received) {
+        total += bytes;
+        result.minShare = std::min(result.minShare, bytes / encoded);
+    }
+    result.meanShare = fds.empty() ? 0.0 : total / encoded / fds.size();
+    result.megabitsPerSecond = total * 8.0 / seconds / 1e6;
+    result.maxPushMicros = maxPushSeconds * 1e6;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    StreamServer::Options options;
+    options.format = StreamServer::Format::PCM;
+    options.port = kPort;
+    if (argc > 1 && !StreamServer::parseFormat(argv[1], options.format)) {
+        std::cerr << "Unknown format: " << argv[1] << std::endl;
+        return 2;
+    }
+
+    bool passed = true;
+    std::cout << std::setw(8) << "clients" << std::setw(11) << "connected" << std::setw(8) << "lost"
+              << std::setw(11) << "min recv" << std::setw(12) << "mean recv" << std::setw(11) << "Mbit/s"
+              << std::setw(9) << "skipped" << std::setw(12) << "push max" << std::endl;
+    Bench::printRule(82);
+
+    for (int clients : kClientCounts) {
+        StreamServer server(options);
+        server.setSampleRate(kRate);
+        if (!server.start()) {
+            return 2;
+        }
+        Result result = runLoad(server, clients);
+        server.stop();
+
+        std::cout << std::fixed << std::setw(8) << clients << std::setw(11) << result.connected
+                  << std::setw(8) << result.disconnected
+                  << std::setw(10) << std::setprecision(1) << 100.0 * result.minShare << "%"
+                  << std::setw(11) << 100.0 * result.meanShare << "%"
+                  << std::setw(11) << result.megabitsPerSecond
+                  << std::setw(9) << result.after.skippedChunks - result.before.skippedChunks
+                  << std::setw(9) << std::setprecision(0) << result.maxPushMicros << " us" << std::endl;
+
+        if (result.connected != clients || result.disconnected != 0 || result.minShare < kMinDelivered) {
+            passed = false;
+        }
+    }
+
+    std::cout << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#include "Bench.h"
+#include "TimeStretch.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Speed of the WSOLA stage at every playback speed, fed decoder-sized
+// blocks the way MusicPlayer's decoding thread does. The factor is audio
+// played (output time) per second of CPU; anything at or below
+// kMinRealtime fails.
+
+namespace {
+
+constexpr int kBlockFrames = 1024;
+constexpr int kSourceSeconds = 4;
+constexpr double kMinRealtime = 20.0;
+
+const int kRates[] = {44100, 48000};
+const int kChannelCounts[] = {2, 6};
+const float kSpeeds[] = {0.5f, 0.75f, 0.9f, 1.1f, 1.25f, 1.5f, 2.0f};
+
+// A few partials with slow vibrato plus noise, so the correlation search
+// has real work to do instead of locking onto a pure tone
+std::vector<int16_t> makeSource(int rate, int channels, std::mt19937& random) {
+    std::normal_distribution<float> noise(0.0f, 0.02f);
+    const size_t frames = static_cast<size_t>(rate) * kSourceSeconds;
+    std::vector<int16_t> source(frames * channels);
+    double phase[3] = {0.0, 0.0, 0.0};
+    const double partials[3] = {220.0, 331.0, 587.0};
+    for (size_t i = 0; i < frames; i++) {
+        double vibrato = 1.0 + 0.01 * std::sin(2.0 * M_PI * 5.0 * i / rate);
+        float value = 0.0f;
+        for (int p = 0; p < 3; p++) {
+            phase[p] += 2.0 * M_PI * partials[p] * vibrato / rate;
+            value += 0.2f * static_cast<float>(std::sin(phase[p]));
+        }
+        for (int c = 0; c < channels; c++) {
+            source[i * channels + c] = static_cast<int16_t>((value + noise(random)) * 32767.0f);
+        }
+    }
+    return source;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 random(1);
+    bool passed = true;
+
+    std::cout << std::setw(7) << "rate" << std::setw(4) << "ch" << std::setw(7) << "speed"
+              << std::setw(12) << "us/block" << std::setw(14) << "x realtime" << std::endl;
+    Bench::printRule(44);
+
+    for (int rate : kRates) {
+        for (int channels : kChannelCounts) {
+            const std::vector<int16_t> source = makeSource(rate, channels, random);
+            const int sourceFrames = static_cast<int>(source.size() / channels);
+            std::vector<int16_t> block(static_cast<size_t>(kBlockFrames) * channels);
+
+            for (float speed : kSpeeds) {
+                TimeStretch stretch;
+                stretch.prepare(rate, channels);
+                stretch.setSpeed(speed);
+
+                // process() works in place on its input, so copy each block
+                // out of the source as the decoder would hand it over
+                int position = 0;
+                int64_t calls = 0;
+                int64_t produced = 0;
+                double seconds = Bench::secondsPerCall([&] {
+                    if (position + kBlockFrames > sourceFrames) {
+                        position = 0;
+                    }
+                    std::copy_n(source.begin() + static_cast<size_t>(position) * channels,
+                                block.size(), block.begin());
+                    position += kBlockFrames;
+
+                    int16_t* output = nullptr;
+                    int frames = stretch.process(block.data(), kBlockFrames, &output);
+                    calls++;
+                    produced += frames;
+                    Bench::keep(frames > 0 ? output[0] : 0);
+                });
+
+                const double outputFrames = static_cast<double>(produced) / calls;
+                const double realtime = outputFrames / rate / seconds;
+                std::cout << std::fixed << std::setw(7) << rate << std::setw(4) << channels
+                          << std::setw(7) << std::setprecision(2) << speed
+                          << std::setw(12) << std::setprecision(1) << seconds * 1e6
+                          << std::setw(14) << std::setprecision(0) << realtime << std::endl;
+
+                if (realtime <= kMinRealtime) {
+                    passed = false;
+                }
+            }
+        }
+    }
+
+    std::cout << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed ? 0 : 1;
+}
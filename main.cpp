@@ -1,10 +1,21 @@
 #include "MusicPlayer.h"
+#include "Fingerprinter.h"
+#include "LibraryIndex.h"
+#include "ParametricEq.h"
+#include "SpectrumAnalyzer.h"
+#include "StreamServer.h"
+#include "Transcoder.h"
 #include <iostream>
 #include <string>
 #include <thread>
 #include <chrono>
 #include <iomanip>
 #include <csignal>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <cmath>
 
 volatile sig_atomic_t g_running = 1;
 
@@ -20,6 +31,12 @@ void printHelp() {
     std::cout << "stop             - Stop playback" << std::endl;
     std::cout << "seek <seconds>   - Seek to specific time" << std::endl;
     std::cout << "volume <0-100>   - Set volume (0-100)" << std::endl;
+    std::cout << "speed <0.5-2.0>  - Set playback speed without changing pitch" << std::endl;
+    std::cout << "eq <band> <hz> <db> [q] - Set EQ band (1-16), 'eq off' to clear" << std::endl;
+    std::cout << "downmix [native|stereo|mono | center|surround|lfe <db|off>] - Output channels" << std::endl;
+    std::cout << "spectrum [secs]  - Show live spectrum meter (default 10s)" << std::endl;
+    std::cout << "stream [start [opus|mp3|pcm] [port] [kbps] | stop] - LAN HTTP stream" << std::endl;
+    std::cout << "library <cmd>    - Library: scan/load/save/artist/prefix/search/albums/shuffle/play" << std::endl;
     std::cout << "info             - Show current track info" << std::endl;
     std::cout << "status           - Show playback status" << std::endl;
     std::cout << "debug            - Show debug information" << std::endl;
@@ -52,27 +69,451 @@ void printTrackInfo(const MusicPlayer& player) {
     std::cout << "Artist: " << player.getMetadata("artist") << std::endl;
     std::cout << "Album: " << player.getMetadata("album") << std::endl;
     std::cout << "Genre: " << player.getMetadata("genre") << std::endl;
+    std::cout << "Output: " << player.getOutputDescription() << std::endl;
     std::cout << "=========================" << std::endl;
 }
 
+std::string formatGain(double gain) {
+    if (gain <= 0.0) {
+        return "off";
+    }
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1) << 20.0 * std::log10(gain) << " dB";
+    return text.str();
+}
+
+void runDownmixCommand(const std::string& arg, MusicPlayer& player) {
+    MusicPlayer::OutputOptions options = player.getOutputOptions();
+    
+    std::istringstream input(arg);
+    std::string sub;
+    std::string value;
+    input >> sub >> value;
+    
+    if (sub.empty()) {
+        std::cout << "\n=== Output Channels ===" << std::endl;
+        std::cout << "Current: " << (player.getOutputDescription().empty() ? "no file loaded"
+                                                                           : player.getOutputDescription())
+                  << std::endl;
+        std::cout << player.getMatrixDescription();
+        std::cout << "Limit: " << (options.maxChannels == 0 ? "native" :
+                                   options.maxChannels == 1 ? "mono" : "stereo") << std::endl;
+        std::cout << "Center: " << formatGain(options.gains.center)
+                  << ", surround: " << formatGain(options.gains.surround)
+                  << ", LFE: " << formatGain(options.gains.lfe) << std::endl;
+        std::cout << "=======================" << std::endl;
+        return;
+    }
+    
+    if (sub == "native" || sub == "stereo" || sub == "mono") {
+        options.maxChannels = sub == "native" ? 0 : sub == "stereo" ? 2 : 1;
+    } else if (sub == "center" || sub == "surround" || sub == "lfe") {
+        double gain = 0.0;
+        if (value != "off") {
+            try {
+                double db = std::stod(value);
+                if (db < -60.0 || db > 6.0) {
+                    std::cout << "Gain must be between -60 and 6 dB." << std::endl;
+                    return;
+                }
+                gain = std::pow(10.0, db / 20.0);
+            } catch (const std::exception& e) {
+                std::cout << "Usage: downmix " << sub << " <db|off>" << std::endl;
+                return;
+            }
+        }
+        double& target = sub == "center" ? options.gains.center :
+                        sub == "surround" ? options.gains.surround : options.gains.lfe;
+        target = gain;
+    } else {
+        std::cout << "Usage: downmix [native|stereo|mono | center|surround|lfe <db|off>]" << std::endl;
+        return;
+    }
+    
+    player.setOutputOptions(options);
+    std::cout << "Output settings updated; they apply when the next file is loaded." << std::endl;
+}
+
+void printEqualizer(const ParametricEq& eq) {
+    std::cout << "\n=== Equalizer ===" << std::endl;
+    int shown = 0;
+    for (int i = 0; i < ParametricEq::MAX_BANDS; i++) {
+        ParametricEq::Band band = eq.getBand(i);
+        if (band.enabled) {
+            std::cout << "Band " << (i + 1) << ": " << band.frequency << " Hz, "
+                      << band.gainDb << " dB, Q " << band.q << std::endl;
+            shown++;
+        }
+    }
+    if (shown == 0) {
+        std::cout << "(flat)" << std::endl;
+    } else if (eq.getPreGainDb() < -0.05f) {
+        std::cout << "Pre-gain: " << std::fixed << std::setprecision(1) << eq.getPreGainDb()
+                  << " dB (headroom for the boosts)" << std::defaultfloat << std::endl;
+    }
+    std::cout << "=================" << std::endl;
+}
+
+void printTapOverhead(const SpectrumAnalyzer& analyzer) {
+    SpectrumAnalyzer::TapStats stats = analyzer.getTapStats();
+    if (stats.blocks == 0 || stats.sampleRate <= 0) {
+        std::cout << "Analyzer tap: no audio yet" << std::endl;
+        return;
+    }
+    
+    // Share of the real-time budget spent in the tap on the decoding thread
+    double audioNanos = (double)stats.frames / stats.sampleRate * 1e9;
+    std::cout << std::fixed << std::setprecision(1)
+              << "Analyzer tap: " << (double)stats.tapNanos / stats.blocks << " ns/block over "
+              << stats.blocks << " blocks, " << std::setprecision(4)
+              << (100.0 * stats.tapNanos / audioNanos) << "% of real time, "
+              << stats.droppedFrames << " frames dropped" << std::endl;
+    std::cout << std::defaultfloat;
+}
+
+void showSpectrum(SpectrumAnalyzer& analyzer, double seconds) {
+    static const char* levels[] = { " ", "\u2581", "\u2582", "\u2583", "\u2584",
+                                    "\u2585", "\u2586", "\u2587", "\u2588" };
+    
+    auto start = std::chrono::steady_clock::now();
+    SpectrumAnalyzer::Snapshot snapshot;
+    while (g_running &&
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds) {
+        if (analyzer.readSnapshot(snapshot)) {
+            std::string line = "\r|";
+            for (int b = 0; b < SpectrumAnalyzer::BAND_COUNT; b++) {
+                // 60 dB range mapped onto 8 bar heights
+                int level = static_cast<int>((snapshot.bands[b] + 60.0f) / 60.0f * 8.0f);
+                line += levels[std::max(0, std::min(8, level))];
+            }
+            std::cout << line << "| peak " << std::fixed << std::setprecision(1) << std::setw(6)
+                      << snapshot.peakDb << " dB  rms " << std::setw(6) << snapshot.rmsDb
+                      << " dB" << std::defaultfloat << std::flush;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(33));
+    }
+    std::cout << std::endl;
+}
+
+void printStreamStats(const StreamServer& server) {
+    StreamServer::Stats stats = server.getStats();
+    std::cout << "\n=== Stream Server ===" << std::endl;
+    std::cout << "Port: " << server.getOptions().port << std::endl;
+    std::cout << "Listeners: " << stats.clients << " (" << stats.totalClients << " total)" << std::endl;
+    std::cout << "Encoded: " << stats.chunks << " chunks, " << stats.bytesEncoded / 1024 << " KiB" << std::endl;
+    std::cout << "Sent: " << stats.bytesSent / 1024 << " KiB" << std::endl;
+    std::cout << "Slow clients: " << stats.skippedChunks << " chunks skipped, "
+              << stats.droppedClients << " dropped" << std::endl;
+    std::cout << "Encoder overruns: " << stats.droppedFrames << " frames" << std::endl;
+    std::cout << "=====================" << std::endl;
+}
+
+void runStreamCommand(const std::string& arg, std::unique_ptr<StreamServer>& server,
+                      MusicPlayer& player) {
+    std::istringstream args(arg);
+    std::string sub;
+    args >> sub;
+    
+    if (sub.empty() || sub == "status") {
+        if (server && server->isRunning()) {
+            printStreamStats(*server);
+        } else {
+            std::cout << "Not streaming." << std::endl;
+        }
+    }
+    else if (sub == "start") {
+        if (server && server->isRunning()) {
+            std::cout << "Already streaming on port " << server->getOptions().port << std::endl;
+            return;
+        }
+        
+        StreamServer::Options options;
+        std::string format;
+        int port = 0, kbps = 0;
+        if (args >> format && !StreamServer::parseFormat(format, options.format)) {
+            std::cout << "Unknown stream format: " << format << " (opus, mp3 or pcm)" << std::endl;
+            return;
+        }
+        if (args >> port) {
+            options.port = port;
+        }
+        if (args >> kbps) {
+            options.bitRate = static_cast<int64_t>(kbps) * 1000;
+        }
+        
+        if (!server) {
+            server = std::make_unique<StreamServer>(options);
+        } else {
+            server->setOptions(options);
+        }
+        if (server->start()) {
+            player.setStreamServer(server.get());
+        } else {
+            std::cout << "Failed to start streaming." << std::endl;
+        }
+    }
+    else if (sub == "stop") {
+        if (server && server->isRunning()) {
+            player.setStreamServer(nullptr);
+            server->stop();
+            std::cout << "Streaming stopped." << std::endl;
+        } else {
+            std::cout << "Not streaming." << std::endl;
+        }
+    }
+    else {
+        std::cout << "Usage: stream [status] | stream start [opus|mp3|pcm] [port] [kbps] | stream stop" << std::endl;
+    }
+}
+
 void printStatus(const MusicPlayer& player) {
     std::cout << "\n=== Player Status ===" << std::endl;
     std::cout << "State: " << stateToString(player.getState()) << std::endl;
     std::cout << "Time: " << formatTime(player.getCurrentTime()) 
               << " / " << formatTime(player.getDuration()) << std::endl;
     std::cout << "Volume: " << static_cast<int>(player.getVolume() * 100) << "%" << std::endl;
+    std::cout << "Speed: " << std::fixed << std::setprecision(2) << player.getSpeed() << "x"
+              << std::defaultfloat << std::endl;
     std::cout << "=====================" << std::endl;
 }
 
+void printLibraryResults(const LibraryIndex& library, const std::vector<uint32_t>& results,
+                         double milliseconds) {
+    const size_t shown = std::min<size_t>(results.size(), 20);
+    for (size_t i = 0; i < shown; i++) {
+        uint32_t track = results[i];
+        std::cout << std::setw(3) << (i + 1) << ". " << library.artist(track) << " - "
+                  << library.title(track) << " [" << library.album(track);
+        if (library.trackNumber(track) > 0) {
+            std::cout << " #" << library.trackNumber(track);
+        }
+        std::cout << "] " << formatTime(library.duration(track)) << std::endl;
+    }
+    if (results.size() > shown) {
+        std::cout << "... " << (results.size() - shown) << " more" << std::endl;
+    }
+    std::cout << results.size() << " tracks in " << std::fixed << std::setprecision(3)
+              << milliseconds << " ms" << std::defaultfloat << std::endl;
+}
+
+void runLibraryCommand(const std::string& arg, LibraryIndex& library,
+                       std::vector<uint32_t>& lastResults, MusicPlayer& player) {
+    size_t spacePos = arg.find(' ');
+    std::string sub = arg.substr(0, spacePos);
+    std::string value = (spacePos != std::string::npos) ? arg.substr(spacePos + 1) : "";
+    
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&start]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    
+    if (sub == "scan" && !value.empty()) {
+        LibraryBuilder builder;
+        size_t added = builder.scanDirectory(value);
+        library.adopt(builder.build());
+        lastResults.clear();
+        std::cout << "Indexed " << added << " tracks in " << std::fixed << std::setprecision(1)
+                  << elapsedMs() / 1000.0 << " s" << std::defaultfloat << std::endl;
+    }
+    else if (sub == "load" && !value.empty()) {
+        if (library.load(value)) {
+            lastResults.clear();
+            std::cout << "Loaded " << library.size() << " tracks in " << std::fixed
+                      << std::setprecision(3) << elapsedMs() << " ms" << std::defaultfloat << std::endl;
+        }
+    }
+    else if (sub == "save" && !value.empty()) {
+        if (library.save(value)) {
+            std::cout << "Saved " << library.size() << " tracks to " << value << std::endl;
+        }
+    }
+    else if (sub == "artist" && !value.empty()) {
+        lastResults = library.findByArtist(value);
+        printLibraryResults(library, lastResults, elapsedMs());
+    }
+    else if (sub == "prefix" && !value.empty()) {
+        lastResults = library.findByTitlePrefix(value);
+        printLibraryResults(library, lastResults, elapsedMs());
+    }
+    else if (sub == "search" && !value.empty()) {
+        lastResults = library.search(value);
+        printLibraryResults(library, lastResults, elapsedMs());
+    }
+    else if (sub == "albums") {
+        lastResults = library.sortedByAlbum();
+        printLibraryResults(library, lastResults, elapsedMs());
+    }
+    else if (sub == "shuffle") {
+        size_t count = value.empty() ? 20 : std::stoul(value);
+        uint64_t seed = std::chrono::steady_clock::now().time_since_epoch().count();
+        lastResults = library.shuffle(seed, count);
+        printLibraryResults(library, lastResults, elapsedMs());
+    }
+    else if (sub == "play" && !value.empty()) {
+        size_t index = std::stoul(value);
+        if (index < 1 || index > lastResults.size()) {
+            std::cout << "No result " << index << " in the last listing." << std::endl;
+            return;
+        }
+        std::string path(library.path(lastResults[index - 1]));
+        if (player.loadFile(path) && player.play()) {
+            std::cout << "Playing: " << path << std::endl;
+        } else {
+            std::cout << "Failed to play: " << path << std::endl;
+        }
+    }
+    else {
+        std::cout << "Usage: library scan <dir> | load <file> | save <file>" << std::endl;
+        std::cout << "       library artist <name> | prefix <title> | search <text>" << std::endl;
+        std::cout << "       library albums | shuffle [n] | play <n>" << std::endl;
+    }
+}
+
+void printTranscodeUsage() {
+    std::cout << "Usage: music_player transcode [options] <files...>" << std::endl;
+    std::cout << "  -c <codec>    opus, mp3, aac, flac, vorbis, wav or encoder name (default: opus)" << std::endl;
+    std::cout << "  -f <ext>      Output extension/container (default depends on codec)" << std::endl;
+    std::cout << "  -b <rate>     Bit rate, e.g. 96k (default: encoder default)" << std::endl;
+    std::cout << "  -r <hz>       Output sample rate (default: source rate)" << std::endl;
+    std::cout << "  -j <n>        Parallel jobs (default: one per core)" << std::endl;
+    std::cout << "  -o <dir>      Output directory (default: current directory)" << std::endl;
+}
+
+// Headless batch mode: no SDL, no interactive prompt
+int runTranscode(int argc, char* argv[]) {
+    Transcoder::Options options;
+    std::vector<std::string> inputs;
+    
+    try {
+        for (int i = 0; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            
+            if (arg == "-c" && hasValue) {
+                options.codec = argv[++i];
+            } else if (arg == "-f" && hasValue) {
+                options.format = argv[++i];
+            } else if (arg == "-b" && hasValue) {
+                std::string value = argv[++i];
+                int64_t multiplier = 1;
+                if (!value.empty() && (value.back() == 'k' || value.back() == 'K')) {
+                    multiplier = 1000;
+                    value.pop_back();
+                }
+                options.bitRate = std::stoll(value) * multiplier;
+            } else if (arg == "-r" && hasValue) {
+                options.sampleRate = std::stoi(argv[++i]);
+            } else if (arg == "-j" && hasValue) {
+                options.jobs = std::stoi(argv[++i]);
+            } else if (arg == "-o" && hasValue) {
+                options.outputDir = argv[++i];
+            } else if (arg == "-h" || arg == "--help") {
+                printTranscodeUsage();
+                return 0;
+            } else if (!arg.empty() && arg[0] == '-') {
+                std::cout << "Unknown option: " << arg << std::endl;
+                printTranscodeUsage();
+                return 1;
+            } else {
+                inputs.push_back(arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Invalid option value." << std::endl;
+        return 1;
+    }
+    
+    if (inputs.empty()) {
+        printTranscodeUsage();
+        return 1;
+    }
+    
+    av_log_set_level(AV_LOG_ERROR);
+    
+    Transcoder transcoder(options);
+    return transcoder.run(inputs) ? 0 : 1;
+}
+
+void printFingerprintUsage() {
+    std::cout << "Usage: music_player fingerprint [options] <files or directories...>" << std::endl;
+    std::cout << "  -j <n>        Parallel jobs (default: one per core)" << std::endl;
+    std::cout << "  -c <file>     Fingerprint cache (default: fingerprints.cache, 'none' disables)" << std::endl;
+    std::cout << "  -t <rate>     Maximum bit error rate for a duplicate (default: 0.35)" << std::endl;
+}
+
+// Headless duplicate finder: no SDL, no interactive prompt
+int runFingerprint(int argc, char* argv[]) {
+    Fingerprinter::Options options;
+    std::vector<std::string> inputs;
+    
+    try {
+        for (int i = 0; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            
+            if (arg == "-j" && hasValue) {
+                options.jobs = std::stoi(argv[++i]);
+            } else if (arg == "-c" && hasValue) {
+                options.cacheFile = argv[++i];
+                if (options.cacheFile == "none") {
+                    options.cacheFile.clear();
+                }
+            } else if (arg == "-t" && hasValue) {
+                options.maxBitErrorRate = std::stof(argv[++i]);
+            } else if (arg == "-h" || arg == "--help") {
+                printFingerprintUsage();
+                return 0;
+            } else if (!arg.empty() && arg[0] == '-') {
+                std::cout << "Unknown option: " << arg << std::endl;
+                printFingerprintUsage();
+                return 1;
+            } else {
+                inputs.push_back(arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Invalid option value." << std::endl;
+        return 1;
+    }
+    
+    if (inputs.empty()) {
+        printFingerprintUsage();
+        return 1;
+    }
+    
+    av_log_set_level(AV_LOG_ERROR);
+    
+    Fingerprinter fingerprinter(options);
+    return fingerprinter.run(inputs) ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "transcode") {
+        return runTranscode(argc - 2, argv + 2);
+    }
+    if (argc > 1 && std::string(argv[1]) == "fingerprint") {
+        return runFingerprint(argc - 2, argv + 2);
+    }
+    
     std::cout << "FFmpeg Music Player v1.0" << std::endl;
     std::cout << "Type 'help' for commands" << std::endl;
     
     std::signal(SIGINT, signalHandler);
     
+    // Declared before the player so it outlives the decoding thread
+    std::unique_ptr<SpectrumAnalyzer> analyzer;
+    std::unique_ptr<StreamServer> streamServer;
+    
     MusicPlayer player;
     std::string command;
     
+    // Added to the DSP chain on first use so a flat EQ costs nothing
+    auto equalizer = std::make_shared<ParametricEq>();
+    bool equalizerAttached = false;
+    
+    LibraryIndex library;
+    std::vector<uint32_t> libraryResults;
+    
     // Auto-load file if provided as argument
     if (argc > 1) {
         std::string filename = argv[1];
@@ -184,6 +625,99 @@ int main(int argc, char* argv[]) {
                 std::cout << "Invalid volume value." << std::endl;
             }
         }
+        else if (cmd == "speed" || cmd == "sd") {
+            if (arg.empty()) {
+                std::cout << "Current speed: " << player.getSpeed() << "x" << std::endl;
+                continue;
+            }
+            
+            try {
+                float speed = std::stof(arg);
+                if (speed >= TimeStretch::MIN_SPEED && speed <= TimeStretch::MAX_SPEED) {
+                    player.setSpeed(speed);
+                    std::cout << "Speed set to " << player.getSpeed() << "x" << std::endl;
+                } else {
+                    std::cout << "Speed must be between " << TimeStretch::MIN_SPEED
+                              << " and " << TimeStretch::MAX_SPEED << "." << std::endl;
+                }
+            } catch (const std::exception& e) {
+                std::cout << "Invalid speed value." << std::endl;
+            }
+        }
+        else if (cmd == "eq") {
+            if (arg.empty()) {
+                printEqualizer(*equalizer);
+                continue;
+            }
+            
+            if (arg == "off") {
+                equalizer->clearBands();
+                if (equalizerAttached) {
+                    player.getDspChain().removeProcessor(equalizer);
+                    equalizerAttached = false;
+                }
+                std::cout << "Equalizer cleared." << std::endl;
+                continue;
+            }
+            
+            std::istringstream args(arg);
+            int index = 0;
+            ParametricEq::Band band;
+            if (!(args >> index >> band.frequency >> band.gainDb) ||
+                index < 1 || index > ParametricEq::MAX_BANDS) {
+                std::cout << "Usage: eq <band 1-16> <hz> <db> [q]" << std::endl;
+                continue;
+            }
+            if (!(args >> band.q)) {
+                band.q = 1.0f;
+            }
+            band.enabled = true;
+            
+            equalizer->setBand(index - 1, band);
+            if (!equalizerAttached) {
+                player.getDspChain().addProcessor(equalizer);
+                equalizerAttached = true;
+            }
+            std::cout << "EQ band " << index << " set to " << band.frequency << " Hz, "
+                      << band.gainDb << " dB" << std::endl;
+        }
+        else if (cmd == "downmix" || cmd == "dm") {
+            runDownmixCommand(arg, player);
+        }
+        else if (cmd == "spectrum" || cmd == "sp") {
+            double seconds = 10.0;
+            if (!arg.empty()) {
+                try {
+                    seconds = std::stod(arg);
+                } catch (const std::exception& e) {
+                    std::cout << "Invalid duration." << std::endl;
+                    continue;
+                }
+            }
+            
+            // Attached on first use so the tap costs nothing until then
+            if (!analyzer) {
+                analyzer = std::make_unique<SpectrumAnalyzer>();
+                analyzer->start();
+                player.setAnalyzer(analyzer.get());
+            }
+            
+            if (player.getState() != MusicPlayer::State::PLAYING) {
+                std::cout << "Not playing; the meter will stay idle." << std::endl;
+            }
+            showSpectrum(*analyzer, seconds);
+            printTapOverhead(*analyzer);
+        }
+        else if (cmd == "stream") {
+            runStreamCommand(arg, streamServer, player);
+        }
+        else if (cmd == "library" || cmd == "lib") {
+            try {
+                runLibraryCommand(arg, library, libraryResults, player);
+            } catch (const std::exception& e) {
+                std::cout << "Invalid number." << std::endl;
+            }
+        }
         else if (cmd == "info" || cmd == "i") {
             if (player.getCurrentFile().empty()) {
                 std::cout << "No file loaded." << std::endl;
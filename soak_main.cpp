@@ -0,0 +1,87 @@
+#include "SoakTest.h"
+#include <iostream>
+#include <string>
+
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+void printSoakUsage() {
+    std::cout << "Usage: music_player_soak [options]" << std::endl;
+    std::cout << "  -n <cycles>        Load/play/seek/stop cycles (default: 2000)" << std::endl;
+    std::cout << "  -t <minutes>       Stop after this long even if cycles remain" << std::endl;
+    std::cout << "  -s <cycles>        Cycles per sample window (default: 50)" << std::endl;
+    std::cout << "  -r <cycles>        Rebuild the player and re-init SDL every n cycles, 0 = never (default: 100)" << std::endl;
+    std::cout << "  -m <dir>           Directory for generated media (default: system temp)" << std::endl;
+    std::cout << "  -o <file>          Write every sample to a CSV file" << std::endl;
+    std::cout << "  -a <driver>        SDL audio driver (default: dummy)" << std::endl;
+    std::cout << "  --seed <n>         Random seed for file, speed and seek choices (default: 1)" << std::endl;
+    std::cout << "Limits on growth between the first and last sample:" << std::endl;
+    std::cout << "  --max-rss <MB>     Resident set size (default: 16)" << std::endl;
+    std::cout << "  --max-heap <MB>    malloc heap in use (default: 8)" << std::endl;
+    std::cout << "  --max-allocs <n>   Live operator new blocks (default: 5000)" << std::endl;
+    std::cout << "  --max-threads <n>  Thread count (default: 0)" << std::endl;
+    std::cout << "  --max-fds <n>      Open file descriptors (default: 0)" << std::endl;
+    std::cout << "  --max-latency <x>  p99 latency ratio per stage (default: 2.0)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    SoakTest::Options options;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (arg == "-n" && hasValue) {
+                options.cycles = std::stoi(argv[++i]);
+            } else if (arg == "-t" && hasValue) {
+                options.maxMinutes = std::stod(argv[++i]);
+            } else if (arg == "-s" && hasValue) {
+                options.sampleEvery = std::stoi(argv[++i]);
+            } else if (arg == "-r" && hasValue) {
+                options.recreateEvery = std::stoi(argv[++i]);
+            } else if (arg == "-m" && hasValue) {
+                options.mediaDir = argv[++i];
+            } else if (arg == "-o" && hasValue) {
+                options.reportFile = argv[++i];
+            } else if (arg == "-a" && hasValue) {
+                options.audioDriver = argv[++i];
+            } else if (arg == "--seed" && hasValue) {
+                options.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (arg == "--max-rss" && hasValue) {
+                options.maxRssGrowthMb = std::stod(argv[++i]);
+            } else if (arg == "--max-heap" && hasValue) {
+                options.maxHeapGrowthMb = std::stod(argv[++i]);
+            } else if (arg == "--max-allocs" && hasValue) {
+                options.maxAllocationGrowth = std::stoll(argv[++i]);
+            } else if (arg == "--max-threads" && hasValue) {
+                options.maxThreadGrowth = std::stoi(argv[++i]);
+            } else if (arg == "--max-fds" && hasValue) {
+                options.maxFileGrowth = std::stoi(argv[++i]);
+            } else if (arg == "--max-latency" && hasValue) {
+                options.maxLatencyGrowth = std::stod(argv[++i]);
+            } else if (arg == "-h" || arg == "--help") {
+                printSoakUsage();
+                return 0;
+            } else {
+                std::cout << "Unknown option: " << arg << std::endl;
+                printSoakUsage();
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Invalid option value." << std::endl;
+        return 1;
+    }
+
+    if (options.cycles <= 0 || options.sampleEvery <= 0) {
+        printSoakUsage();
+        return 1;
+    }
+
+    av_log_set_level(AV_LOG_ERROR);
+
+    SoakTest soak(options);
+    return soak.run() ? 0 : 1;
+}